@@ -0,0 +1,297 @@
+#ifndef GRID_2D_SO2U
+#define GRID_2D_SO2U
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace mew {
+	// Row-major 2D storage shared by the game_of_life boards, the craft
+	// layers and tof maps.
+	// Rows are padded so every interior row starts on an Align-byte
+	// boundary, and an optional halo of `halo` cells surrounds the grid
+	// so stencils can read x-1 / y+1 at the edges without a modulo:
+	// row(y) is valid for y in [-halo, height+halo) and row(y)[x] for
+	// x in [-halo, width+halo). Copying duplicates the cells, swap()
+	// only exchanges pointers.
+	template<typename T, size_t Align = 64>
+	class Grid2D {
+		static_assert(Align >= alignof(T) && (Align & (Align - 1)) == 0,
+			"alignment must be a power of two and fit T");
+	private:
+		size_t width = 0U, height = 0U, halo = 0U;
+		size_t lead = 0U;       /* elements before column 0, >= halo */
+		size_t stride = 0U;     /* elements per row, halo and padding included */
+		T* _data = nullptr;
+
+		////////////////////////////////////////////////////////////
+		static constexpr size_t per_align() noexcept {
+			return Align % sizeof(T) == 0 ? Align / sizeof(T) : 1U;
+		}
+
+		////////////////////////////////////////////////////////////
+		static constexpr size_t round_up(size_t n, size_t to) noexcept {
+			return (n + to - 1) / to * to;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t rows() const noexcept {
+			return height + 2U*halo;
+		}
+
+		////////////////////////////////////////////////////////////
+		void allocate() {
+			lead = halo == 0U ? 0U : round_up(halo, per_align());
+			stride = round_up(lead + width + halo, per_align());
+			size_t count = stride*rows();
+			if (count == 0U) { return; }
+			_data = static_cast<T*>(::operator new(count*sizeof(T), std::align_val_t(Align)));
+			std::uninitialized_value_construct_n(_data, count);
+		}
+
+		////////////////////////////////////////////////////////////
+		void release() noexcept {
+			if (_data == nullptr) { return; }
+			std::destroy_n(_data, stride*rows());
+			::operator delete(_data, std::align_val_t(Align));
+			_data = nullptr;
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		Grid2D() {}
+
+		////////////////////////////////////////////////////////////
+		Grid2D(size_t _w, size_t _h, size_t _halo = 0U): width(_w), height(_h), halo(_halo) {
+			allocate();
+		}
+
+		////////////////////////////////////////////////////////////
+		Grid2D(size_t _w, size_t _h, size_t _halo, const T& val): width(_w), height(_h), halo(_halo) {
+			allocate();
+			fill(val);
+		}
+
+		////////////////////////////////////////////////////////////
+		Grid2D(const Grid2D& other): width(other.width), height(other.height), halo(other.halo) {
+			allocate();
+			std::copy_n(other._data, stride*rows(), _data);
+		}
+
+		////////////////////////////////////////////////////////////
+		Grid2D(Grid2D&& other) noexcept {
+			swap(other);
+		}
+
+		////////////////////////////////////////////////////////////
+		Grid2D& operator=(Grid2D other) noexcept {
+			swap(other);
+			return *this;
+		}
+
+		////////////////////////////////////////////////////////////
+		~Grid2D() {
+			release();
+		}
+
+		////////////////////////////////////////////////////////////
+		void swap(Grid2D& other) noexcept {
+			std::swap(width, other.width);
+			std::swap(height, other.height);
+			std::swap(halo, other.halo);
+			std::swap(lead, other.lead);
+			std::swap(stride, other.stride);
+			std::swap(_data, other._data);
+		}
+
+		////////////////////////////////////////////////////////////
+		void resize(size_t _w, size_t _h, size_t _halo = 0U) {
+			Grid2D next(_w, _h, _halo);
+			swap(next);
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return width;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return height;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Halo() const noexcept {
+			return halo;
+		}
+
+		////////////////////////////////////////////////////////////
+		// distance between two rows, in elements
+		size_t Stride() const noexcept {
+			return stride;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t size() const noexcept {
+			return width*height;
+		}
+
+		////////////////////////////////////////////////////////////
+		bool empty() const noexcept {
+			return _data == nullptr;
+		}
+
+		////////////////////////////////////////////////////////////
+		// column 0 of row y; y may reach into the halo
+		T* row(ptrdiff_t y) noexcept {
+			return _data + (ptrdiff_t)lead + (y + (ptrdiff_t)halo)*(ptrdiff_t)stride;
+		}
+
+		////////////////////////////////////////////////////////////
+		const T* row(ptrdiff_t y) const noexcept {
+			return _data + (ptrdiff_t)lead + (y + (ptrdiff_t)halo)*(ptrdiff_t)stride;
+		}
+
+		////////////////////////////////////////////////////////////
+		// the width interior cells of row y
+		std::span<T> span(size_t y) noexcept {
+			return std::span<T>(row((ptrdiff_t)y), width);
+		}
+
+		////////////////////////////////////////////////////////////
+		std::span<const T> span(size_t y) const noexcept {
+			return std::span<const T>(row((ptrdiff_t)y), width);
+		}
+
+		////////////////////////////////////////////////////////////
+		T& operator()(ptrdiff_t x, ptrdiff_t y) noexcept {
+			return row(y)[x];
+		}
+
+		////////////////////////////////////////////////////////////
+		const T& operator()(ptrdiff_t x, ptrdiff_t y) const noexcept {
+			return row(y)[x];
+		}
+
+		////////////////////////////////////////////////////////////
+		const T& get(size_t x, size_t y) const noexcept {
+			return row((ptrdiff_t)y)[x];
+		}
+
+		////////////////////////////////////////////////////////////
+		void set(size_t x, size_t y, const T& val) noexcept {
+			row((ptrdiff_t)y)[x] = val;
+		}
+
+		////////////////////////////////////////////////////////////
+		// every cell, halo included
+		void fill(const T& val) {
+			std::fill_n(_data, stride*rows(), val);
+		}
+
+		////////////////////////////////////////////////////////////
+		// copies interior cells of another grid of the same size
+		void copyFrom(const Grid2D& other) {
+			for (size_t y = 0; y < height; ++y) {
+				std::copy_n(other.row((ptrdiff_t)y), width, row((ptrdiff_t)y));
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		void fillHalo(const T& val) {
+			const ptrdiff_t h = (ptrdiff_t)halo, w = (ptrdiff_t)width;
+			for (ptrdiff_t y = -h; y < (ptrdiff_t)height + h; ++y) {
+				T* r = row(y);
+				if (y < 0 || y >= (ptrdiff_t)height) {
+					std::fill(r - h, r + w + h, val);
+				} else {
+					std::fill(r - h, r, val);
+					std::fill(r + w, r + w + h, val);
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// torus: the halo mirrors the opposite edges (corners included)
+		void wrapHalo() {
+			const ptrdiff_t h = (ptrdiff_t)halo, w = (ptrdiff_t)width, hh = (ptrdiff_t)height;
+			if (h == 0) { return; }
+			for (ptrdiff_t y = 0; y < hh; ++y) {
+				T* r = row(y);
+				for (ptrdiff_t k = 1; k <= h; ++k) {
+					r[-k] = r[((w - k) % w + w) % w];
+					r[w + k - 1] = r[(k - 1) % w];
+				}
+			}
+			for (ptrdiff_t k = 1; k <= h; ++k) {
+				std::copy(row(((hh - k) % hh + hh) % hh) - h, row(((hh - k) % hh + hh) % hh) + w + h, row(-k) - h);
+				std::copy(row((k - 1) % hh) - h, row((k - 1) % hh) + w + h, row(hh + k - 1) - h);
+			}
+		}
+	};
+
+	// Front/back pair for generation stepping: readers use front(),
+	// the step writes back(), flip() exchanges them by pointer.
+	template<typename T, size_t Align = 64>
+	class PingPongGrid2D {
+	private:
+		Grid2D<T, Align> _front;
+		Grid2D<T, Align> _back;
+
+	public:
+		////////////////////////////////////////////////////////////
+		PingPongGrid2D() {}
+
+		////////////////////////////////////////////////////////////
+		PingPongGrid2D(size_t _w, size_t _h, size_t _halo = 0U)
+			: _front(_w, _h, _halo), _back(_w, _h, _halo) {}
+
+		////////////////////////////////////////////////////////////
+		Grid2D<T, Align>& front() noexcept {
+			return _front;
+		}
+
+		////////////////////////////////////////////////////////////
+		const Grid2D<T, Align>& front() const noexcept {
+			return _front;
+		}
+
+		////////////////////////////////////////////////////////////
+		Grid2D<T, Align>& back() noexcept {
+			return _back;
+		}
+
+		////////////////////////////////////////////////////////////
+		const Grid2D<T, Align>& back() const noexcept {
+			return _back;
+		}
+
+		////////////////////////////////////////////////////////////
+		void flip() noexcept {
+			_front.swap(_back);
+		}
+
+		////////////////////////////////////////////////////////////
+		void fill(const T& val) {
+			_front.fill(val);
+			_back.fill(val);
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return _front.Width();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return _front.Height();
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef ATLAS_HPP
+#define ATLAS_HPP
+extern "C" {
+	#include "raylib.h"
+}
+#include "mewall.h"
+#include <algorithm>
+#include <vector>
+
+// Sprites packed into a few big textures so consecutive block draws
+// share a texture and raylib can batch them. Each page is filled by a
+// shelf packer: a sprite goes on the shelf that wastes the least
+// height, or opens a new shelf under the last one, or a new page.
+// Sprites can be added at any time, a new one is written straight into
+// its page texture.
+class Atlas {
+public:
+	struct Entry {
+		size_t page = 0;
+		Rectangle source = {0, 0, 0, 0};
+	};
+
+private:
+	struct Shelf {
+		int y, height, x;
+	};
+
+	struct Page {
+		Texture2D texture;
+		int width, height;
+		std::vector<Shelf> shelves;
+		int bottom = 0;    /* first row below the last shelf */
+	};
+
+	int page_size;
+	int padding;
+	std::vector<Page> m_pages;
+
+	////////////////////////////////////////////////////////////
+	Page& new_page(int w, int h) {
+		Image blank = GenImageColor(w, h, BLANK);
+		Page page;
+		page.texture = LoadTextureFromImage(blank);
+		page.width = w;
+		page.height = h;
+		UnloadImage(blank);
+		SetTextureFilter(page.texture, TEXTURE_FILTER_POINT);
+		m_pages.push_back(page);
+		return m_pages.back();
+	}
+
+	////////////////////////////////////////////////////////////
+	// places a w x h box on the page, false when it does not fit
+	bool place(Page& page, int w, int h, int& x, int& y) {
+		Shelf* best = nullptr;
+		for (Shelf& shelf: page.shelves) {
+			if (shelf.height >= h && shelf.x + w <= page.width &&
+				(best == nullptr || shelf.height < best->height)) {
+				best = &shelf;
+			}
+		}
+		if (best == nullptr) {
+			if (page.bottom + h > page.height || w > page.width) { return false; }
+			page.shelves.push_back((Shelf){page.bottom, h, 0});
+			page.bottom += h;
+			best = &page.shelves.back();
+		}
+		x = best->x;
+		y = best->y;
+		best->x += w;
+		return true;
+	}
+
+public:
+	////////////////////////////////////////////////////////////
+	Atlas(int _page_size = 2048, int _padding = 1)
+		: page_size(_page_size), padding(_padding) {}
+
+	////////////////////////////////////////////////////////////
+	// packs the image and uploads its pixels, the image is left as is
+	Entry add(Image image) {
+		Image pixels = ImageCopy(image);
+		ImageFormat(&pixels, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+		const int w = pixels.width + padding, h = pixels.height + padding;
+		Entry entry;
+		int x = 0, y = 0;
+		bool placed = false;
+		for (size_t i = 0; i < m_pages.size() && !placed; ++i) {
+			if (place(m_pages[i], w, h, x, y)) {
+				entry.page = i;
+				placed = true;
+			}
+		}
+		if (!placed) {
+			/* a sprite bigger than a page gets a page of its own */
+			Page& page = new_page(std::max(page_size, w), std::max(page_size, h));
+			entry.page = m_pages.size() - 1;
+			bool fits = place(page, w, h, x, y);
+			MewUserAssert(fits, "cannot place sprite in atlas");
+		}
+		entry.source = (Rectangle){(float)x, (float)y, (float)pixels.width, (float)pixels.height};
+		UpdateTextureRec(m_pages[entry.page].texture, entry.source, pixels.data);
+		UnloadImage(pixels);
+		return entry;
+	}
+
+	////////////////////////////////////////////////////////////
+	Texture2D& texture(size_t page) {
+		return m_pages[page].texture;
+	}
+
+	////////////////////////////////////////////////////////////
+	size_t Pages() const noexcept {
+		return m_pages.size();
+	}
+
+	////////////////////////////////////////////////////////////
+	void clear() {
+		for (Page& page: m_pages) {
+			UnloadTexture(page.texture);
+		}
+		m_pages.clear();
+	}
+};
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef CHUNKS_HPP
+#define CHUNKS_HPP
+
+#include "mewall.h"
+#include "Grid2D.hpp"
+#include <algorithm>
+#include <memory>
+
+constexpr size_t chunk_size = 16;
+
+// Square block of Size x Size cells. A chunk that holds one value
+// everywhere keeps only that value; cells are allocated on the first
+// write that breaks the uniformity and dropped again by compact().
+template<typename T, size_t Size = chunk_size>
+class Chunk {
+private:
+	std::unique_ptr<T[]> m_cells;
+	T m_value = T();
+
+public:
+	////////////////////////////////////////////////////////////
+	Chunk() {}
+
+	////////////////////////////////////////////////////////////
+	Chunk(const Chunk& other): m_value(other.m_value) {
+		if (other.m_cells) {
+			m_cells.reset(new T[Size*Size]);
+			std::copy_n(other.m_cells.get(), Size*Size, m_cells.get());
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	Chunk& operator=(const Chunk& other) {
+		if (this != &other) {
+			Chunk copy(other);
+			m_cells.swap(copy.m_cells);
+			m_value = copy.m_value;
+		}
+		return *this;
+	}
+
+	Chunk(Chunk&&) noexcept = default;
+	Chunk& operator=(Chunk&&) noexcept = default;
+
+	////////////////////////////////////////////////////////////
+	bool is_uniform() const noexcept {
+		return !m_cells;
+	}
+
+	////////////////////////////////////////////////////////////
+	// the value of a uniform chunk
+	const T& value() const noexcept {
+		return m_value;
+	}
+
+	////////////////////////////////////////////////////////////
+	void fill(const T& val) {
+		m_cells.reset();
+		m_value = val;
+	}
+
+	////////////////////////////////////////////////////////////
+	const T& get(size_t x, size_t y) const noexcept {
+		return m_cells ? m_cells[y*Size + x] : m_value;
+	}
+
+	////////////////////////////////////////////////////////////
+	void set(size_t x, size_t y, const T& val) {
+		if (!m_cells) {
+			if (val == m_value) { return; }
+			m_cells.reset(new T[Size*Size]);
+			std::fill_n(m_cells.get(), Size*Size, m_value);
+		}
+		m_cells[y*Size + x] = val;
+	}
+
+	////////////////////////////////////////////////////////////
+	// row y of a dense chunk, nullptr for a uniform one
+	const T* row(size_t y) const noexcept {
+		return m_cells ? m_cells.get() + y*Size : nullptr;
+	}
+
+	////////////////////////////////////////////////////////////
+	// back to a single value if every cell holds the same one
+	bool compact() {
+		if (!m_cells) { return true; }
+		const T first = m_cells[0];
+		if (!std::all_of(m_cells.get(), m_cells.get() + Size*Size,
+			[&](const T& v) { return v == first; })) {
+			return false;
+		}
+		fill(first);
+		return true;
+	}
+};
+
+// Width x height cells stored as a table of chunks. Reads and writes
+// go through the chunk that owns the cell; memory is spent only on
+// chunks whose cells differ. Chunks are also the unit the world
+// renders, saves and ticks.
+template<typename T, size_t Size = chunk_size>
+class ChunkGrid {
+public:
+	typedef Chunk<T, Size> chunk_type;
+	static constexpr size_t size = Size;
+
+private:
+	size_t width = 0, height = 0;
+	mew::Grid2D<chunk_type> m_chunks;
+
+public:
+	////////////////////////////////////////////////////////////
+	ChunkGrid() {}
+
+	////////////////////////////////////////////////////////////
+	ChunkGrid(size_t _w, size_t _h, const T& val = T()) {
+		resize(_w, _h, val);
+	}
+
+	////////////////////////////////////////////////////////////
+	void resize(size_t _w, size_t _h, const T& val = T()) {
+		width = _w;
+		height = _h;
+		m_chunks.resize((_w + Size - 1) / Size, (_h + Size - 1) / Size);
+		fill(val);
+	}
+
+	////////////////////////////////////////////////////////////
+	void fill(const T& val) {
+		for (size_t cy = 0; cy < m_chunks.Height(); ++cy) {
+			for (size_t cx = 0; cx < m_chunks.Width(); ++cx) {
+				m_chunks(cx, cy).fill(val);
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	size_t Width() const noexcept {
+		return width;
+	}
+
+	////////////////////////////////////////////////////////////
+	size_t Height() const noexcept {
+		return height;
+	}
+
+	////////////////////////////////////////////////////////////
+	// chunks per row of the table
+	size_t ChunksX() const noexcept {
+		return m_chunks.Width();
+	}
+
+	////////////////////////////////////////////////////////////
+	// chunk rows of the table
+	size_t ChunksY() const noexcept {
+		return m_chunks.Height();
+	}
+
+	////////////////////////////////////////////////////////////
+	const chunk_type& chunk(size_t cx, size_t cy) const noexcept {
+		return m_chunks(cx, cy);
+	}
+
+	////////////////////////////////////////////////////////////
+	const T& get(size_t x, size_t y) const noexcept {
+		return m_chunks(x / Size, y / Size).get(x % Size, y % Size);
+	}
+
+	////////////////////////////////////////////////////////////
+	void set(size_t x, size_t y, const T& val) {
+		m_chunks(x / Size, y / Size).set(x % Size, y % Size, val);
+	}
+
+	////////////////////////////////////////////////////////////
+	// collapses the chunk of cell (x, y) if it became uniform
+	bool compact(size_t x, size_t y) {
+		return m_chunks(x / Size, y / Size).compact();
+	}
+
+	////////////////////////////////////////////////////////////
+	// collapses chunks that became uniform, returns the dense ones left
+	size_t compact() {
+		size_t dense = 0;
+		for (size_t cy = 0; cy < m_chunks.Height(); ++cy) {
+			for (size_t cx = 0; cx < m_chunks.Width(); ++cx) {
+				dense += m_chunks(cx, cy).compact() ? 0 : 1;
+			}
+		}
+		return dense;
+	}
+
+	////////////////////////////////////////////////////////////
+	// chunks holding per-cell storage
+	size_t dense() const noexcept {
+		size_t count = 0;
+		for (size_t cy = 0; cy < m_chunks.Height(); ++cy) {
+			for (size_t cx = 0; cx < m_chunks.Width(); ++cx) {
+				count += m_chunks(cx, cy).is_uniform() ? 0 : 1;
+			}
+		}
+		return count;
+	}
+};
+
+#endif
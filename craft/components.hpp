@@ -0,0 +1,137 @@
+#ifndef COMPONENTS_HPP
+#define COMPONENTS_HPP
+
+#include "mewall.h"
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// Components of type T keyed by a 32-bit index (a cell of a layer).
+// Values sit packed in a dense array, so walking every live component
+// is a linear loop; the sparse side maps a key to its dense slot and
+// is allocated in pages only where keys were used. Removing swaps the
+// last component into the hole, so dense order is not stable.
+template<typename T, size_t PageSize = 4096>
+class SparseSet {
+public:
+	typedef uint32_t key_type;
+	static constexpr uint32_t npos = -1;
+
+private:
+	std::vector<std::vector<uint32_t>> m_pages;  /* key -> dense slot */
+	std::vector<key_type> m_keys;
+	std::vector<T> m_values;
+
+	////////////////////////////////////////////////////////////
+	uint32_t slot(key_type key) const noexcept {
+		const size_t page = key / PageSize;
+		if (page >= m_pages.size() || m_pages[page].empty()) { return npos; }
+		return m_pages[page][key % PageSize];
+	}
+
+	////////////////////////////////////////////////////////////
+	uint32_t& slot_ref(key_type key) {
+		const size_t page = key / PageSize;
+		if (page >= m_pages.size()) {
+			m_pages.resize(page + 1);
+		}
+		if (m_pages[page].empty()) {
+			m_pages[page].assign(PageSize, npos);
+		}
+		return m_pages[page][key % PageSize];
+	}
+
+public:
+	////////////////////////////////////////////////////////////
+	SparseSet() {}
+
+	////////////////////////////////////////////////////////////
+	bool contains(key_type key) const noexcept {
+		return slot(key) != npos;
+	}
+
+	////////////////////////////////////////////////////////////
+	// component of key, nullptr when it has none
+	T* get(key_type key) noexcept {
+		const uint32_t i = slot(key);
+		return i == npos ? nullptr : &m_values[i];
+	}
+
+	////////////////////////////////////////////////////////////
+	const T* get(key_type key) const noexcept {
+		const uint32_t i = slot(key);
+		return i == npos ? nullptr : &m_values[i];
+	}
+
+	////////////////////////////////////////////////////////////
+	// sets the component of key, adding it if missing
+	T& set(key_type key, T value) {
+		uint32_t& i = slot_ref(key);
+		if (i != npos) {
+			m_values[i] = std::move(value);
+			return m_values[i];
+		}
+		i = m_values.size();
+		m_keys.push_back(key);
+		m_values.push_back(std::move(value));
+		return m_values.back();
+	}
+
+	////////////////////////////////////////////////////////////
+	// false when key had no component
+	bool erase(key_type key) {
+		const uint32_t i = slot(key);
+		if (i == npos) { return false; }
+		const uint32_t last = m_values.size() - 1;
+		if (i != last) {
+			m_values[i] = std::move(m_values[last]);
+			m_keys[i] = m_keys[last];
+			slot_ref(m_keys[i]) = i;
+		}
+		m_values.pop_back();
+		m_keys.pop_back();
+		slot_ref(key) = npos;
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////
+	size_t size() const noexcept {
+		return m_values.size();
+	}
+
+	////////////////////////////////////////////////////////////
+	bool empty() const noexcept {
+		return m_values.empty();
+	}
+
+	////////////////////////////////////////////////////////////
+	// key of the i-th live component
+	key_type key(size_t i) const noexcept {
+		return m_keys[i];
+	}
+
+	////////////////////////////////////////////////////////////
+	// i-th live component, the one of key(i)
+	T& value(size_t i) noexcept {
+		return m_values[i];
+	}
+
+	////////////////////////////////////////////////////////////
+	const std::vector<key_type>& keys() const noexcept {
+		return m_keys;
+	}
+
+	////////////////////////////////////////////////////////////
+	std::vector<T>& values() noexcept {
+		return m_values;
+	}
+
+	////////////////////////////////////////////////////////////
+	void clear() {
+		m_pages.clear();
+		m_keys.clear();
+		m_values.clear();
+	}
+};
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef JOBS_HPP
+#define JOBS_HPP
+
+#include "mewall.h"
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool of worker threads running short jobs. Every worker has its own
+// deque: it takes its newest job first and, when it runs dry, steals
+// the oldest job of another worker. The thread that waits for the jobs
+// runs them too, so a pool without workers still gets them done.
+// Jobs must not touch raylib: drawing and texture uploads stay on the
+// main thread.
+class JobSystem {
+public:
+	typedef std::function<void()> job_t;
+
+private:
+	struct Queue {
+		std::mutex lock;
+		std::deque<job_t> jobs;
+	};
+
+	std::vector<std::unique_ptr<Queue>> m_queues;  /* one per worker, the last for waiters */
+	std::vector<std::thread> m_threads;
+	std::mutex m_sleep;
+	std::condition_variable m_wake;
+	size_t queued = 0;                 /* submitted, not taken; under m_sleep */
+	std::atomic<size_t> pending{0};    /* submitted, not finished */
+	std::atomic<size_t> next{0};
+	bool stopping = false;
+
+	////////////////////////////////////////////////////////////
+	// own queue newest first, then the oldest job of the others
+	bool take(size_t self, job_t& job) {
+		for (size_t i = 0; i < m_queues.size(); ++i) {
+			Queue& queue = *m_queues[(self + i) % m_queues.size()];
+			std::lock_guard<std::mutex> guard(queue.lock);
+			if (queue.jobs.empty()) { continue; }
+			if (i == 0) {
+				job = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+			} else {
+				job = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+			}
+			std::lock_guard<std::mutex> sleep(m_sleep);
+			--queued;
+			return true;
+		}
+		return false;
+	}
+
+	////////////////////////////////////////////////////////////
+	void run(job_t& job) {
+		job();
+		if (--pending == 0) {
+			std::lock_guard<std::mutex> guard(m_sleep);
+			m_wake.notify_all();
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	void worker(size_t self) {
+		job_t job;
+		for (;;) {
+			if (take(self, job)) {
+				run(job);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(m_sleep);
+			m_wake.wait(lock, [&] { return stopping || queued > 0; });
+			if (stopping && queued == 0) { return; }
+		}
+	}
+
+public:
+	////////////////////////////////////////////////////////////
+	// 0 workers is one per hardware thread besides the caller
+	JobSystem(size_t workers = 0) {
+		if (workers == 0) {
+			workers = std::max<size_t>(1, std::thread::hardware_concurrency()) - 1;
+		}
+		for (size_t i = 0; i <= workers; ++i) {
+			m_queues.push_back(std::make_unique<Queue>());
+		}
+		for (size_t i = 0; i < workers; ++i) {
+			m_threads.emplace_back(&JobSystem::worker, this, i);
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	~JobSystem() {
+		wait();
+		{
+			std::lock_guard<std::mutex> guard(m_sleep);
+			stopping = true;
+		}
+		m_wake.notify_all();
+		for (std::thread& t: m_threads) {
+			t.join();
+		}
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	////////////////////////////////////////////////////////////
+	size_t Workers() const noexcept {
+		return m_threads.size();
+	}
+
+	////////////////////////////////////////////////////////////
+	void submit(job_t job) {
+		++pending;
+		/* counted before it is visible, so a take() never drops queued below 0 */
+		{
+			std::lock_guard<std::mutex> guard(m_sleep);
+			++queued;
+		}
+		Queue& queue = *m_queues[next++ % m_queues.size()];
+		{
+			std::lock_guard<std::mutex> guard(queue.lock);
+			queue.jobs.push_back(std::move(job));
+		}
+		m_wake.notify_one();
+	}
+
+	////////////////////////////////////////////////////////////
+	// runs jobs until every submitted one finished
+	void wait() {
+		const size_t self = m_queues.size() - 1;
+		job_t job;
+		while (pending > 0) {
+			if (take(self, job)) {
+				run(job);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(m_sleep);
+			m_wake.wait(lock, [&] { return pending == 0 || queued > 0; });
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	// fn(i) for i in [0, count), returns when all are done
+	template<typename Fn>
+	void parallel_for(size_t count, Fn&& fn) {
+		for (size_t i = 0; i < count; ++i) {
+			submit([&fn, i] { fn(i); });
+		}
+		wait();
+	}
+
+	////////////////////////////////////////////////////////////
+	// fn(cx, cy) for every chunk of a w x h table, in nine phases:
+	// chunks of a phase are three apart, so a call may read and write
+	// the cells of its chunk and the cells touching it while the
+	// others run. Cells further out are not safe: a write on the far
+	// edge of a neighbour chunk marks chunks another call may mark
+	// too. A job takes the chunks of one row of a phase.
+	template<typename Fn>
+	void for_chunks(size_t w, size_t h, Fn&& fn) {
+		for (size_t py = 0; py < 3; ++py) {
+			for (size_t px = 0; px < std::min<size_t>(3, w); ++px) {
+				for (size_t cy = py; cy < h; cy += 3) {
+					submit([&fn, px, cy, w] {
+						for (size_t cx = px; cx < w; cx += 3) {
+							fn(cx, cy);
+						}
+					});
+				}
+				wait();
+			}
+		}
+	}
+};
+
+// Lock for classes that get copied: a copy gets a lock of its own.
+struct JobLock {
+	std::mutex m;
+
+	JobLock() {}
+	JobLock(const JobLock&) {}
+	JobLock& operator=(const JobLock&) { return *this; }
+	void lock() { m.lock(); }
+	void unlock() { m.unlock(); }
+};
+
+// Random numbers of one chunk job. Streams are keyed by a seed and the
+// chunk, so results do not depend on which thread ran the job or when,
+// and no job touches the shared GetRandomValue state.
+struct ChunkRandom {
+	uint64_t state;
+
+	////////////////////////////////////////////////////////////
+	ChunkRandom(uint64_t seed, size_t cx, size_t cy)
+		: state(seed ^ (cx*0x9E3779B97F4A7C15ull) ^ (cy*0xC2B2AE3D27D4EB4Full)) {}
+
+	////////////////////////////////////////////////////////////
+	// splitmix64
+	uint64_t next() noexcept {
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27))*0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	////////////////////////////////////////////////////////////
+	// uniform in [0, n)
+	size_t below(size_t n) noexcept {
+		return next() % n;
+	}
+
+	////////////////////////////////////////////////////////////
+	// uniform in [0, 1)
+	double unit() noexcept {
+		return (next() >> 11)*0x1.0p-53;
+	}
+};
+
+static JobSystem* current_jobs = nullptr;
+JobSystem* GetJobSystem() {
+	if (current_jobs == nullptr) {
+		current_jobs = new JobSystem();
+	}
+	return current_jobs;
+}
+
+#endif
@@ -67,6 +67,8 @@ int main(void) {
 		PollInputEvents();
 		/* PRE UPDATE */
 		WorldContext::Update(world, main_player);
+		/* once per frame, Update runs twice */
+		world.tick(GetFrameTime());
 		_e_key_f11(stored_w, stored_h);
 		if (!IsWindowFullscreen()) {
 			stored_w = GetScreenWidth();
@@ -74,7 +76,7 @@ int main(void) {
 		}
 		main_player.zoomit();
 		main_player.Update();
-		WorldContext::Render(world);
+		WorldContext::Render(world, main_player.camera);
 		Vector2 v2 = WorldContext::GetCellPosByMouse(main_player.camera, world);
 		/* END UPDATE */
 		/* DRAWING */
@@ -0,0 +1,100 @@
+#ifndef TICKS_HPP
+#define TICKS_HPP
+
+#include "mewall.h"
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+// Cells waiting for a tick, kept on a hashed timing wheel: an entry due
+// at tick t waits in slot t % Slots, so advancing one tick looks only
+// at the entries of one slot instead of at every placed block. Due
+// entries queue up until run() processes them; whatever a frame's
+// budget leaves is carried over to the next run().
+template<size_t Slots = 256>
+class BasicTickScheduler {
+public:
+	struct Entry {
+		uint64_t tick;
+		uint32_t cell;
+	};
+
+private:
+	std::vector<std::vector<Entry>> m_wheel = std::vector<std::vector<Entry>>(Slots);
+	std::deque<Entry> m_due;
+	uint64_t now = 0;
+	size_t waiting = 0;
+
+public:
+	////////////////////////////////////////////////////////////
+	BasicTickScheduler() {}
+
+	////////////////////////////////////////////////////////////
+	uint64_t Now() const noexcept {
+		return now;
+	}
+
+	////////////////////////////////////////////////////////////
+	// entries on the wheel, not due yet
+	size_t Waiting() const noexcept {
+		return waiting;
+	}
+
+	////////////////////////////////////////////////////////////
+	// entries due and not processed yet
+	size_t Due() const noexcept {
+		return m_due.size();
+	}
+
+	////////////////////////////////////////////////////////////
+	// the cell is due `delay` ticks from now, returns that tick
+	uint64_t schedule(uint32_t cell, uint64_t delay = 1) {
+		const uint64_t tick = now + std::max<uint64_t>(delay, 1);
+		m_wheel[tick % Slots].push_back((Entry){tick, cell});
+		++waiting;
+		return tick;
+	}
+
+	////////////////////////////////////////////////////////////
+	// next tick: entries due at it join the due queue
+	void advance() {
+		++now;
+		std::vector<Entry>& slot = m_wheel[now % Slots];
+		for (size_t i = 0; i < slot.size();) {
+			if (slot[i].tick == now) {
+				m_due.push_back(slot[i]);
+				slot[i] = slot.back();
+				slot.pop_back();
+				--waiting;
+			} else { ++i; }
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	// calls fn(entry) on due entries, oldest first, until `budget` of
+	// them did work (fn returned true); returns how many did
+	template<typename Fn>
+	size_t run(size_t budget, Fn&& fn) {
+		size_t done = 0;
+		while (done < budget && !m_due.empty()) {
+			Entry entry = m_due.front();
+			m_due.pop_front();
+			done += fn(entry) ? 1 : 0;
+		}
+		return done;
+	}
+
+	////////////////////////////////////////////////////////////
+	void clear() {
+		for (std::vector<Entry>& slot: m_wheel) {
+			slot.clear();
+		}
+		m_due.clear();
+		waiting = 0;
+	}
+};
+
+typedef BasicTickScheduler<> TickScheduler;
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef TILES_HPP
+#define TILES_HPP
+extern "C" {
+	#include "raylib.h"
+}
+#include "mewall.h"
+#include <list>
+#include <unordered_map>
+
+// Square render textures cached by key, least recently used first out.
+// The cache holds at most `budget` bytes of tiles that were not used
+// in the current frame: tiles that scroll out of view stay around
+// until the memory is needed, and an evicted texture is reused for the
+// next tile instead of being unloaded.
+class TileCache {
+public:
+	struct Tile {
+		RenderTexture2D target;
+		uint64_t key = 0;
+		uint version = 0;      /* what the contents were drawn from */
+		bool drawn = false;
+		size_t frame = 0;      /* last frame the tile was used */
+	};
+
+private:
+	size_t tile_px;
+	size_t budget;
+	size_t frame = 0;
+	std::list<Tile> m_lru;  /* most recently used first */
+	std::unordered_map<uint64_t, std::list<Tile>::iterator> m_index;
+
+	////////////////////////////////////////////////////////////
+	void unload(Tile& tile) {
+		UnloadRenderTexture(tile.target);
+	}
+
+public:
+	////////////////////////////////////////////////////////////
+	TileCache(size_t _tile_px, size_t _budget = 96*1024*1024)
+		: tile_px(_tile_px), budget(_budget) {}
+
+	////////////////////////////////////////////////////////////
+	~TileCache() {
+		clear();
+	}
+
+	TileCache(const TileCache&) = delete;
+	TileCache& operator=(const TileCache&) = delete;
+
+	////////////////////////////////////////////////////////////
+	static uint64_t Key(size_t slot, size_t cx, size_t cy) {
+		return ((uint64_t)slot << 48) | ((uint64_t)cy << 24) | (uint64_t)cx;
+	}
+
+	////////////////////////////////////////////////////////////
+	static size_t Slot(uint64_t key) {
+		return key >> 48;
+	}
+
+	////////////////////////////////////////////////////////////
+	size_t TileBytes() const noexcept {
+		return tile_px*tile_px*4;
+	}
+
+	////////////////////////////////////////////////////////////
+	size_t Used() const noexcept {
+		return m_lru.size()*TileBytes();
+	}
+
+	////////////////////////////////////////////////////////////
+	size_t Count() const noexcept {
+		return m_lru.size();
+	}
+
+	////////////////////////////////////////////////////////////
+	size_t Budget() const noexcept {
+		return budget;
+	}
+
+	////////////////////////////////////////////////////////////
+	void setBudget(size_t bytes) {
+		budget = bytes;
+		trim();
+	}
+
+	////////////////////////////////////////////////////////////
+	// tiles acquired after this call are the ones in use
+	void beginFrame() {
+		++frame;
+	}
+
+	////////////////////////////////////////////////////////////
+	Tile* find(uint64_t key) {
+		auto it = m_index.find(key);
+		return it == m_index.end() ? nullptr : &*it->second;
+	}
+
+	////////////////////////////////////////////////////////////
+	// the tile for key, marked used this frame; a new tile comes back
+	// with drawn == false and has to be drawn by the caller
+	Tile& acquire(uint64_t key) {
+		auto it = m_index.find(key);
+		if (it != m_index.end()) {
+			m_lru.splice(m_lru.begin(), m_lru, it->second);
+			m_lru.front().frame = frame;
+			return m_lru.front();
+		}
+		if (!m_lru.empty() && Used() + TileBytes() > budget && m_lru.back().frame != frame) {
+			/* recycle the stalest texture */
+			m_lru.splice(m_lru.begin(), m_lru, std::prev(m_lru.end()));
+			m_index.erase(m_lru.front().key);
+		} else {
+			m_lru.emplace_front();
+			m_lru.front().target = LoadRenderTexture(tile_px, tile_px);
+		}
+		Tile& tile = m_lru.front();
+		tile.key = key;
+		tile.drawn = false;
+		tile.frame = frame;
+		m_index[key] = m_lru.begin();
+		return tile;
+	}
+
+	////////////////////////////////////////////////////////////
+	void release(uint64_t key) {
+		auto it = m_index.find(key);
+		if (it == m_index.end()) { return; }
+		unload(*it->second);
+		m_lru.erase(it->second);
+		m_index.erase(it);
+	}
+
+	////////////////////////////////////////////////////////////
+	// tiles of a slot are drawn again on their next acquire
+	void invalidate(size_t slot) {
+		for (Tile& tile: m_lru) {
+			if (Slot(tile.key) == slot) { tile.drawn = false; }
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	// evicts tiles not used this frame until the cache fits its budget
+	void trim() {
+		while (!m_lru.empty() && Used() > budget && m_lru.back().frame != frame) {
+			m_index.erase(m_lru.back().key);
+			unload(m_lru.back());
+			m_lru.pop_back();
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	void clear() {
+		for (Tile& tile: m_lru) {
+			unload(tile);
+		}
+		m_lru.clear();
+		m_index.clear();
+	}
+};
+
+#endif
@@ -2,13 +2,22 @@
 #define WORLD_HPP
 
 #include "mewall.h"
+#include "chunks.hpp"
+#include "components.hpp"
+#include "ticks.hpp"
+#include "jobs.hpp"
+#include "tiles.hpp"
+#include "atlas.hpp"
 #include "noise.hpp"
 #include "particles.hpp"
 #include <vector>
 #include <algorithm>
 #include <numeric>
+#include <climits>
 #include <cmath>
 #include <initializer_list>
+#include <string>
+#include <unordered_map>
 #include "data_set.hpp"
 #include "ui.hpp"
 #include "inventory.hpp"
@@ -25,18 +34,55 @@ const auto& same_s = mew::string::SameStr;
 typedef uint CellID;
 static CellID empty_cell = -1;
 
+class Layer;
+struct DynCellData;
+
 struct DynCellInfo { 
+	// runs when the block's scheduled tick comes, returns the ticks
+	// until the next one or 0 to sleep until scheduled again; data is
+	// only valid until the layer is changed
+	typedef uint(*tick_t)(Layer& layer, size_t x, size_t y, DynCellData& data);
 	const char* script_path;
+	tick_t on_tick = nullptr;
 };
 
+// Sprite sheet of an animated block. The frame shown is derived from
+// the global animation clock, never from how often the block is drawn,
+// so every copy of a block shows the same frame at any frame rate.
 struct CellInfoAnimation {
 	enum Direction: byte {
 		Rows, Colums, RowsWithColumns,
 	};
-	float x, y, w, h, frame_w, frame_h;
-	float factor = 0.0f;
+	/* frames per second at speed 1 */
+	static constexpr float frame_rate = 12.0f;
+	float w, h, frame_w, frame_h;
 	float speed = 1.0f;
 	Direction direction = Rows;
+	std::vector<Rectangle> frames;  /* source rects, in play order */
+	size_t frame = 0;               /* shown since the last tick */
+
+	////////////////////////////////////////////////////////////
+	// source rects of every frame of a sheet placed at `sheet`
+	void build(Rectangle sheet) {
+		frames.clear();
+		const size_t columns = direction == Colums ? 1 : (size_t)(w / frame_w);
+		const size_t rows = direction == Rows ? 1 : (size_t)(h / frame_h);
+		for (size_t row = 0; row < std::max<size_t>(rows, 1); ++row) {
+			for (size_t col = 0; col < std::max<size_t>(columns, 1); ++col) {
+				frames.push_back((Rectangle){
+					sheet.x + col*frame_w, sheet.y + row*frame_h, frame_w, frame_h
+				});
+			}
+		}
+		frame = 0;
+	}
+
+	////////////////////////////////////////////////////////////
+	// frame shown `time` seconds into the clock
+	size_t frame_at(double time) const noexcept {
+		if (frames.size() < 2) { return 0; }
+		return (size_t)(time*frame_rate*speed) % frames.size();
+	}
 };
 
 struct CellInfo {
@@ -44,10 +90,16 @@ struct CellInfo {
 	const char* display_name;
 	Image image;
 	Texture2D texture;
+	Rectangle source = {0, 0, 0, 0};  /* sprite within texture */
+	bool packed = false;              /* texture is an atlas page */
 	Color color;
 	float rotation = 0.0f;
 	CellInfoAnimation* animation = nullptr;
 	DynCellInfo* dyn_info = nullptr;
+	/* ambient effect, run on cells picked at random every tick; runs
+	 * on chunk jobs, so it may only touch cells of its chunk or next
+	 * to it, and must not read dynamic state (get_dyn, Dynamic) */
+	void (*random_tick)(Layer& layer, size_t x, size_t y) = nullptr;
 };
 
 // Function to get the mixed color from an image
@@ -79,17 +131,69 @@ Color GetMixedColorFromImage(Image image) {
 	return GetMixedColorFromImage(image, (Rectangle){0,0, (float)image.width, (float)image.height});
 }
 
+// Registry of block kinds. Names resolve once through a hash map to
+// dense CellIDs; the flags edit and render loops ask for on every cell
+// live in an array indexed by id. Registered infos are read-only from
+// outside, changes go through edit() so the flags follow them.
 class GameStorage {
 public:
+	enum CellFlags: byte {
+		DynFlag = 1, AnimatedFlag = 2, RandomTickFlag = 4,
+	};
+
 	////////////////////////////////////////////////////////////
+	/* every uploaded sprite, so block draws share textures */
+	Atlas atlas;
+
+private:
 	std::vector<CellInfo> cells_info;
+	std::unordered_map<std::string, CellID> m_ids;
+	std::vector<byte> m_flags;
+	std::vector<CellID> m_animated;  /* blocks the clock advances */
+
+	////////////////////////////////////////////////////////////
+	// flags of block id taken from its info again
+	void refresh(CellID id) {
+		const CellInfo& info = cells_info[id];
+		m_flags[id] = (info.dyn_info != nullptr ? DynFlag : 0) |
+			(info.animation != nullptr ? AnimatedFlag : 0) |
+			(info.random_tick != nullptr ? RandomTickFlag : 0);
+		auto it = std::find(m_animated.begin(), m_animated.end(), id);
+		if (info.animation != nullptr && it == m_animated.end()) {
+			m_animated.push_back(id);
+		} else if (info.animation == nullptr && it != m_animated.end()) {
+			m_animated.erase(it);
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	// appends the info and its flags, the first block registered
+	// under a name keeps it
+	const CellInfo& store(CellInfo& info) {
+		const CellID id = cells_info.size();
+		cells_info.push_back(info);
+		m_ids.emplace(info.name, id);
+		m_flags.push_back(0);
+		refresh(id);
+		return cells_info.back();
+	}
+
+public:
+	////////////////////////////////////////////////////////////
+	// packs the image into the atlas and points the info at it
+	void pack(CellInfo& info, Image image) {
+		Atlas::Entry entry = atlas.add(image);
+		info.texture = atlas.texture(entry.page);
+		info.source = entry.source;
+		info.packed = true;
+	}
 
 	////////////////////////////////////////////////////////////
 	GameStorage() {
 		CellInfo ci;
 		ci.display_name = "error_block";
 		ci.name 				= "error_block";
-		cells_info.push_back(ci);
+		store(ci);
 	}
 
 	////////////////////////////////////////////////////////////
@@ -99,33 +203,27 @@ public:
 
 	////////////////////////////////////////////////////////////
 	GameStorage& add(CellInfo& info) {
-		cells_info.push_back(info);
+		if (!info.packed && info.source.width == 0) {
+			info.source = (Rectangle){0, 0, (float)info.texture.width, (float)info.texture.height};
+		}
+		store(info);
 		return *this;
 	}
 
 	////////////////////////////////////////////////////////////
 	CellID getID(const char* name) {
-		for (CellID id = 0; id < cells_info.size(); ++id) {
-			if (same_s(cells_info[id].name, name)) {
-				return id;
-			}
-		}
-		return empty_cell;
+		auto it = m_ids.find(name);
+		return it == m_ids.end() ? empty_cell : it->second;
 	}
 
 	////////////////////////////////////////////////////////////
-	CellInfo* get(const char* name) {
-		for (CellID id = 0; id < cells_info.size(); ++id) {
-			if (same_s(cells_info[id].name, name)) {
-				return &cells_info[id];
-			}
-		}
-		return nullptr;
+	const CellInfo* get(const char* name) {
+		return get(getID(name));
 	}
 
 	////////////////////////////////////////////////////////////
-	CellInfo* get(CellID id) {
-		if (!id >= cells_info.size()) {
+	const CellInfo* get(CellID id) {
+		if (id >= cells_info.size()) {
 			return nullptr;
 		}
 		return &cells_info[id];
@@ -133,69 +231,115 @@ public:
 
 	////////////////////////////////////////////////////////////
 	bool is_dyn(const char* name) {
-		CellInfo* info = get(name);
-		MewUserAssert(info != nullptr, "cannot find block");
-		return info->dyn_info != nullptr;
+		CellID id = getID(name);
+		MewUserAssert(id != empty_cell, "cannot find block");
+		return is_dyn(id);
+	}
+
+	////////////////////////////////////////////////////////////
+	// false for empty_cell
+	bool is_dyn(CellID id) const noexcept {
+		return id < m_flags.size() && (m_flags[id] & DynFlag);
+	}
+
+	////////////////////////////////////////////////////////////
+	// false for empty_cell
+	bool is_animated(CellID id) const noexcept {
+		return id < m_flags.size() && (m_flags[id] & AnimatedFlag);
+	}
+
+	////////////////////////////////////////////////////////////
+	// false for empty_cell
+	bool has_random_tick(CellID id) const noexcept {
+		return id < m_flags.size() && (m_flags[id] & RandomTickFlag);
+	}
+
+	////////////////////////////////////////////////////////////
+	// fn(info) may change the registered block, its flags are taken
+	// again after; blocks already placed keep their old state
+	template<typename Fn>
+	void edit(CellID id, Fn&& fn) {
+		MewUserAssert(id < cells_info.size(), "cannot find block");
+		fn(cells_info[id]);
+		refresh(id);
+	}
+
+	////////////////////////////////////////////////////////////
+	// moves every animation to its frame at `time` seconds, true when
+	// any block shows a different frame than before
+	bool animate(double time) {
+		bool advanced = false;
+		for (CellID id: m_animated) {
+			CellInfoAnimation* anima = cells_info[id].animation;
+			const size_t frame = anima->frame_at(time);
+			if (frame != anima->frame) {
+				anima->frame = frame;
+				advanced = true;
+			}
+		}
+		return advanced;
 	}
 
 	////////////////////////////////////////////////////////////
-	bool is_dyn(CellID id) {
-		CellInfo* info = get(id);
-		MewUserAssert(info != nullptr, "cannot find block");
-		return info->dyn_info != nullptr;
+	size_t size() const noexcept {
+		return cells_info.size();
 	}
 
 	////////////////////////////////////////////////////////////
-	CellInfo& upload(const char* path, const char* diplay_name, const char* name) {
+	const CellInfo& upload(const char* path, const char* diplay_name, const char* name) {
 		Image image = LoadImage(path);
 		// ImageFlip(&image);
-		Texture2D texture = LoadTextureFromImage(image);  
 		CellInfo cm_info;
 		cm_info.display_name  = diplay_name;
 		cm_info.name 				  = name;
 		cm_info.image 	  		= image;
 		cm_info.color 				= GetMixedColorFromImage(image);
-		cm_info.texture 		  = texture;
-		cells_info.push_back(cm_info);
+		pack(cm_info, image);
 		UnloadImage(image);
-		return cells_info.back();
+		return store(cm_info);
 	}
 
 	////////////////////////////////////////////////////////////
-	CellInfo& upload(
+	const CellInfo& upload(
 		const char* path, const char* diplay_name, const char* name, 
 		CellInfoAnimation::Direction direction, size_t frame_w, size_t frame_h, 
 		float speed = 1.0f
 	){
 		Image image = LoadImage(path);
-		Texture2D texture = LoadTextureFromImage(image);  
 		CellInfo cm_info;
 		cm_info.display_name  = diplay_name;
 		cm_info.name 				  = name;
 		cm_info.image 	  		= image;
 		cm_info.color 				= GetMixedColorFromImage(image);
-		cm_info.texture 		  = texture;
+		pack(cm_info, image);
 		CellInfoAnimation* anima = new CellInfoAnimation();
-		anima->x = 0;
-		anima->y = 0;
 		anima->w = image.width;
 		anima->h = image.height;
 		anima->frame_w = frame_w;
 		anima->frame_h = frame_h;
+		anima->speed = speed;
 		anima->direction = direction;
+		anima->build(cm_info.source);
 		cm_info.animation = anima;
 		UnloadImage(image);
-		cells_info.push_back(cm_info);
-		return cells_info.back();
+		return store(cm_info);
 	}
 
 	////////////////////////////////////////////////////////////
 	void clear() {
 		for (uint i = 0; i < cells_info.size(); ++i) {
 			auto info = cells_info[i];
-			UnloadTexture(info.texture);
+			/* atlas pages are shared, they go with the atlas */
+			if (!info.packed) {
+				UnloadTexture(info.texture);
+			}
+			delete info.animation;
 		}
 		cells_info.clear();
+		m_ids.clear();
+		m_flags.clear();
+		m_animated.clear();
+		atlas.clear();
 	}
 };
 
@@ -221,7 +365,14 @@ ParticleSystem* GetParticleSystemTop() {
 	return top_particle_system;
 }
 
-typedef char* DynCellData;
+// State of one placed dynamic block. Only cells holding a dynamic
+// block have one, kept in the layer's sparse set.
+struct DynCellData {
+	CellID block = empty_cell;   /* the block the state was made for */
+	uint ticks = 0;              /* ticks the block has received */
+	uint64_t next_tick = 0;      /* tick it is scheduled for, 0 if none */
+	std::vector<byte> memory;    /* owned by the block's script */
+};
 
 #pragma pack(push, 1)
 struct CellType {
@@ -230,63 +381,280 @@ struct CellType {
 };
 #pragma pack(pop)
 
-inline char* NaD = (char*)"NaD"; 
-
+// One plane of the world, stored as chunk_size x chunk_size chunks.
+// An untouched layer is a table of uniform chunks, so overlay layers
+// cost memory only where blocks were put.
 class Layer {
+public:
+	typedef ChunkGrid<CellID>::chunk_type Chunk;
 private:
-	std::vector<CellID> m_blocks;
-	std::vector<DynCellData> m_dyn_blocks;
+	ChunkGrid<CellID> m_blocks;
+	/* keyed by y*width + x, one entry per placed dynamic block */
+	SparseSet<DynCellData> m_dyn_blocks;
+	TickScheduler m_ticks;
+	/* dynamic state and ticks are shared by every chunk job */
+	JobLock m_dyn_lock;
+	/* per chunk: bumped on every change, and where its animated blocks are */
+	mew::Grid2D<uint> m_versions;
+	mew::Grid2D<std::vector<uint16_t>> m_animated;
+
+	////////////////////////////////////////////////////////////
+	static bool is_animated(CellID id) {
+		return current_storage->is_animated(id);
+	}
+
+	////////////////////////////////////////////////////////////
+	// first tick of a dynamic block just placed
+	void wake(SparseSet<DynCellData>::key_type key, DynCellData& data) {
+		data.next_tick = 0;
+		if (current_storage->get(data.block)->dyn_info->on_tick != nullptr) {
+			data.next_tick = m_ticks.schedule(key);
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	void touch(size_t x, size_t y, CellID before, CellID after) {
+		const size_t cx = x / chunk_size, cy = y / chunk_size;
+		const size_t lx = x % chunk_size, ly = y % chunk_size;
+		/* a block on the chunk border spills into the neighbour chunks */
+		for (int dy = -1; dy <= 1; ++dy) {
+			if ((dy < 0 && (ly != 0 || cy == 0)) || (dy > 0 && (ly != chunk_size-1 || cy+1 >= ChunksY()))) { continue; }
+			for (int dx = -1; dx <= 1; ++dx) {
+				if ((dx < 0 && (lx != 0 || cx == 0)) || (dx > 0 && (lx != chunk_size-1 || cx+1 >= ChunksX()))) { continue; }
+				++m_versions(cx + dx, cy + dy);
+			}
+		}
+		if (is_animated(after) == is_animated(before)) { return; }
+		std::vector<uint16_t>& cells = m_animated(cx, cy);
+		const uint16_t local = ly*chunk_size + lx;
+		if (is_animated(after)) {
+			cells.push_back(local);
+		} else {
+			/* a layer filled before the storage existed has no list */
+			auto it = std::find(cells.begin(), cells.end(), local);
+			if (it == cells.end()) { return; }
+			*it = cells.back();
+			cells.pop_back();
+		}
+	}
 public:
 	////////////////////////////////////////////////////////////
 	Layer() {}
 	
 	////////////////////////////////////////////////////////////
-	void fill(size_t size, CellID id = empty_cell) {
-		m_blocks.resize(size, id);
-		m_dyn_blocks.resize(size, NaD);
+	void fill(size_t width, size_t height, CellID id = empty_cell) {
+		m_blocks.resize(width, height, id);
+		m_dyn_blocks.clear();
+		m_ticks.clear();
+		if (current_storage != nullptr && current_storage->is_dyn(id)) {
+			for (size_t y = 0; y < height; ++y) {
+				for (size_t x = 0; x < width; ++x) {
+					wake(y*width + x, m_dyn_blocks.set(y*width + x, DynCellData{id}));
+				}
+			}
+		}
+		m_versions.resize(m_blocks.ChunksX(), m_blocks.ChunksY());
+		m_versions.fill(0);
+		m_animated.resize(m_blocks.ChunksX(), m_blocks.ChunksY());
+		const bool animated = current_storage != nullptr && is_animated(id);
+		for (size_t cy = 0; cy < ChunksY(); ++cy) {
+			for (size_t cx = 0; cx < ChunksX(); ++cx) {
+				std::vector<uint16_t>& cells = m_animated(cx, cy);
+				cells.clear();
+				if (!animated) { continue; }
+				const size_t w = std::min(chunk_size, width - cx*chunk_size);
+				const size_t h = std::min(chunk_size, height - cy*chunk_size);
+				for (size_t ly = 0; ly < h; ++ly) {
+					for (size_t lx = 0; lx < w; ++lx) {
+						cells.push_back(ly*chunk_size + lx);
+					}
+				}
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	size_t Width() const noexcept {
+		return m_blocks.Width();
+	}
+
+	////////////////////////////////////////////////////////////
+	size_t Height() const noexcept {
+		return m_blocks.Height();
+	}
+
+	////////////////////////////////////////////////////////////
+	size_t ChunksX() const noexcept {
+		return m_blocks.ChunksX();
+	}
+
+	////////////////////////////////////////////////////////////
+	size_t ChunksY() const noexcept {
+		return m_blocks.ChunksY();
+	}
+
+	////////////////////////////////////////////////////////////
+	const Chunk& chunk(size_t cx, size_t cy) const noexcept {
+		return m_blocks.chunk(cx, cy);
 	}
 
 	////////////////////////////////////////////////////////////
-	void set(size_t idx, CellID cell, DynCellData data = nullptr) {
+	// a dynamic block gets fresh state, or a copy of `data`; state of
+	// a replaced dynamic block is dropped
+	void set(size_t x, size_t y, CellID cell, const DynCellData* data = nullptr) {
 		MewAssert(current_storage != nullptr);
-		m_blocks[idx] = cell;
-		if (cell != empty_cell && 
-			current_storage->is_dyn(cell) && 
-			data != nullptr) {
-			m_dyn_blocks[idx] = data;
+		const CellID before = m_blocks.get(x, y);
+		if (before != cell || data != nullptr) {
+			touch(x, y, before, cell);
+		}
+		m_blocks.set(x, y, cell);
+		if (cell == empty_cell) {
+			/* erasing may leave a chunk of empty cells behind */
+			m_blocks.compact(x, y);
+		}
+		if (!current_storage->is_dyn(cell) && !current_storage->is_dyn(before)) { return; }
+		const SparseSet<DynCellData>::key_type key = y*Width() + x;
+		std::lock_guard<JobLock> guard(m_dyn_lock);
+		if (current_storage->is_dyn(cell)) {
+			if (data != nullptr) {
+				DynCellData& placed = m_dyn_blocks.set(key, *data);
+				placed.block = cell;
+				wake(key, placed);
+			} else if (before != cell || !m_dyn_blocks.contains(key)) {
+				wake(key, m_dyn_blocks.set(key, DynCellData{cell}));
+			}
+		} else {
+			m_dyn_blocks.erase(key);
 		}
 	}
 
 	////////////////////////////////////////////////////////////
-	CellID& get(size_t idx) {
-		MewUserAssert(idx < m_blocks.size(), "undefined cell id");
-		return m_blocks[idx];
+	CellID get(size_t x, size_t y) const {
+		MewUserAssert(x < Width() && y < Height(), "undefined cell id");
+		return m_blocks.get(x, y);
 	}
+
 	////////////////////////////////////////////////////////////
-	DynCellData& get_dyn(size_t idx) {
-		MewUserAssert(idx < m_dyn_blocks.size(), "undefined cell id");
-		return m_dyn_blocks[idx];
+	// changes whenever a cell of chunk (cx, cy) does
+	uint Version(size_t cx, size_t cy) const noexcept {
+		return m_versions(cx, cy);
 	}
 
 	////////////////////////////////////////////////////////////
-	bool is_dyn(size_t idx) {
+	// animated blocks in chunk (cx, cy)
+	uint Animated(size_t cx, size_t cy) const noexcept {
+		return m_animated(cx, cy).size();
+	}
+
+	////////////////////////////////////////////////////////////
+	// cells of chunk (cx, cy) holding animated blocks, as
+	// y*chunk_size + x within the chunk
+	const std::vector<uint16_t>& AnimatedCells(size_t cx, size_t cy) const noexcept {
+		return m_animated(cx, cy);
+	}
+
+	////////////////////////////////////////////////////////////
+	// state of the dynamic block at (x, y), nullptr for other cells;
+	// not for chunk jobs, a set() on another chunk may move it
+	DynCellData* get_dyn(size_t x, size_t y) {
+		MewUserAssert(x < Width() && y < Height(), "undefined cell id");
+		return m_dyn_blocks.get(y*Width() + x);
+	}
+
+	////////////////////////////////////////////////////////////
+	// every placed dynamic block, packed for ticking; key(i) is
+	// y*Width() + x of the i-th
+	SparseSet<DynCellData>& Dynamic() noexcept {
+		return m_dyn_blocks;
+	}
+
+	////////////////////////////////////////////////////////////
+	// ticks the dynamic block at (x, y) `delay` ticks from now, in
+	// place of its pending tick; false when there is none
+	bool schedule(size_t x, size_t y, uint delay = 1) {
+		std::lock_guard<JobLock> guard(m_dyn_lock);
+		DynCellData* data = get_dyn(x, y);
+		if (data == nullptr) { return false; }
+		data->next_tick = m_ticks.schedule(y*Width() + x, delay);
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////
+	// the next tick: scheduled blocks due at it queue up
+	void advance() {
+		m_ticks.advance();
+	}
+
+	////////////////////////////////////////////////////////////
+	// random ticks of `count` cells of chunk (cx, cy); safe to run
+	// for chunks three apart at once (JobSystem::for_chunks)
+	void random_tick(size_t cx, size_t cy, size_t count) {
+		const Chunk& chunk = m_blocks.chunk(cx, cy);
+		if (chunk.is_uniform() && !current_storage->has_random_tick(chunk.value())) { return; }
+		const size_t w = std::min(chunk_size, Width() - cx*chunk_size);
+		const size_t h = std::min(chunk_size, Height() - cy*chunk_size);
+		ChunkRandom random(m_ticks.Now(), cx, cy);
+		for (size_t i = 0; i < count; ++i) {
+			const size_t x = random.below(w), y = random.below(h);
+			const CellID cid = chunk.get(x, y);
+			if (current_storage->has_random_tick(cid)) {
+				current_storage->get(cid)->random_tick(*this, cx*chunk_size + x, cy*chunk_size + y);
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	// ticks up to `budget` due blocks, the rest wait for the next
+	// call; returns the blocks ticked
+	size_t run_ticks(size_t budget) {
+		return m_ticks.run(budget, [&](const TickScheduler::Entry& entry) {
+			DynCellData* data = m_dyn_blocks.get(entry.cell);
+			/* removed or rescheduled since */
+			if (data == nullptr || data->next_tick != entry.tick) { return false; }
+			const size_t x = entry.cell % Width(), y = entry.cell / Width();
+			const CellID block = data->block;
+			data->next_tick = 0;
+			++data->ticks;
+			/* the tick may replace the block: data is not used after it */
+			const uint delay = current_storage->get(block)->dyn_info->on_tick(*this, x, y, *data);
+			data = m_dyn_blocks.get(entry.cell);
+			if (delay > 0 && data != nullptr && data->block == block && data->next_tick == 0) {
+				data->next_tick = m_ticks.schedule(entry.cell, delay);
+			}
+			return true;
+		});
+	}
+
+	////////////////////////////////////////////////////////////
+	TickScheduler& Ticks() noexcept {
+		return m_ticks;
+	}
+
+	////////////////////////////////////////////////////////////
+	// drops the cell storage of chunks that became uniform again
+	void compact() {
+		m_blocks.compact();
+	}
+
+	////////////////////////////////////////////////////////////
+	bool is_dyn(size_t x, size_t y) {
 		MewAssert(current_storage != nullptr);
-		CellID cid = get(idx);
+		CellID cid = get(x, y);
 		return GetCurrentGameStorage()->is_dyn(cid);
 	}
 
 	////////////////////////////////////////////////////////////
-	bool is_static(size_t idx) {
+	bool is_static(size_t x, size_t y) {
 		MewAssert(current_storage != nullptr);
-		CellID cid = get(idx);
+		CellID cid = get(x, y);
 		return !GetCurrentGameStorage()->is_dyn(cid);
 	}
 
 	////////////////////////////////////////////////////////////
-	CellType get_type(size_t idx) {
+	CellType get_type(size_t x, size_t y) {
 		CellType ct;
-		ct.has_static  = is_static(idx);
-		ct.has_dynamic = is_dyn(idx);
+		ct.has_static  = is_static(x, y);
+		ct.has_dynamic = is_dyn(x, y);
 		return ct;
 	}
 };
@@ -308,51 +676,29 @@ void DrawTextureRec(Texture2D texture, Rectangle source, Vector2 position, float
 void DrawTexture(Texture2D texture, int posX, int posY, float rotation, Color tint) {
 	DrawTextureEx(texture, (Vector2){ (float)posX, (float)posY }, rotation, 1.0f, tint);
 }
+void DrawTexture(Texture2D texture, Rectangle source, int posX, int posY, float rotation, Color tint) {
+	Rectangle dest = { (float)posX, (float)posY, fabsf(source.width), fabsf(source.height) };
+	DrawTexturePro(texture, source, dest, (Vector2){0.0f, 0.0f}, rotation, tint);
+}
 
 class CellContext {
 public:
-	static void DrawAnimated(float x, float y, CellInfo* ci, DynCellData data = nullptr) {
-		CellInfoAnimation* anima = ci->animation;
-		Rectangle rect;
-		rect.x = anima->x;
-		rect.y = anima->y;
-		rect.width = anima->frame_w;
-		rect.height = anima->frame_h;
+	static void DrawAnimated(float x, float y, const CellInfo* ci, float rotation, const DynCellData* data = nullptr) {
+		const CellInfoAnimation* anima = ci->animation;
 		Vector2 pos = {x, y};
-		DrawTextureRec(ci->texture, rect, pos, ci->rotation, WHITE);
-		if (++anima->factor >= anima->speed) {
-			anima->factor = 0;
-		} else { return; }
-
-		switch (anima->direction) {
-			case CellInfoAnimation::Rows:
-				anima->x += anima->frame_w;
-				anima->x = mew::rclamp(anima->x, 0.0f, anima->w);
-			break;
-			case CellInfoAnimation::Colums:
-				anima->y += anima->frame_h;
-				anima->y = mew::rclamp(anima->y, 0.0f, anima->h);
-			break;
-			case CellInfoAnimation::RowsWithColumns:
-				// todo check for work'
-				anima->x += anima->frame_w;
-				mew::rclamp2d(
-					anima->x, anima->y, 
-					0, anima->w, 
-					0, anima->h, 
-					anima->frame_w, anima->frame_h
-				);
-			break;
-			default: MewUserAssert(false, "unsupported animation format"); break;
-		}
-
-	}
-
-	static void Draw(float x, float y, CellInfo* ci, DynCellData data = nullptr) {
+		DrawTextureRec(ci->texture, anima->frames[anima->frame], pos, rotation, WHITE);
+	}
+
+	static void Draw(float x, float y, const CellInfo* ci, const DynCellData* data = nullptr) {
+		DrawRotated(x, y, ci, ci->rotation, data);
+	}
+
+	// the block turned by `rotation` instead of its own
+	static void DrawRotated(float x, float y, const CellInfo* ci, float rotation, const DynCellData* data = nullptr) {
 		if (ci->animation != nullptr) {
-			DrawAnimated(x, y, ci, data);
+			DrawAnimated(x, y, ci, rotation, data);
 		} else {
-			DrawTexture(ci->texture, x, y, ci->rotation, WHITE);
+			DrawTexture(ci->texture, ci->source, x, y, rotation, WHITE);
 		}
 	}
 
@@ -366,19 +712,184 @@ public:
 	}
 };
 
+// The world is drawn through chunk-sized render tiles: the floor and
+// the current layer each get a tile per visible chunk, kept in an LRU
+// TileCache under a memory budget, so only what the camera sees ever
+// has a texture.
 class World {
 friend class WorldContext;
 public:
-	typedef struct {
-		RenderTexture2D main;
-		RenderTexture2D sub;
-	} RenderTextures;
+	enum TileSlot: size_t {
+		FloorTiles, LayerTiles,
+	};
+	static inline const size_t tile_px = chunk_size*cell_size;
+	/* seconds per world tick */
+	static inline const float tick_time = 1.0f/20.0f;
+	/* scheduled blocks ticked per frame, the rest carry over */
+	size_t tick_budget = 4096;
+	/* cells per chunk given a random tick every world tick */
+	size_t random_ticks = 3;
 private:
 	size_t width, height;
 	std::vector<Layer> layers;
 	uint current_layer = 0;
 	bool should_render = true;
-	RenderTextures r_texture;
+	TileCache tiles = TileCache(tile_px);
+	size_t sub_layer = -1;
+	/* chunks in view at the last render() */
+	size_t view_x0 = 0, view_y0 = 0, view_x1 = 0, view_y1 = 0;
+	/* animated cells of the tile being updated */
+	std::vector<std::pair<size_t, size_t>> m_redraw;
+	/* seconds since the last world tick */
+	float tick_clock = 0.0f;
+
+	////////////////////////////////////////////////////////////
+	// blocks of cells [x0, x1) x [y0, y1); chunks of empty cells are
+	// skipped whole
+	void draw_cells(Layer& l, size_t x0, size_t y0, size_t x1, size_t y1) {
+		for (size_t cy = y0 / chunk_size; cy*chunk_size < y1; ++cy) {
+			for (size_t cx = x0 / chunk_size; cx*chunk_size < x1; ++cx) {
+				const Layer::Chunk& chunk = l.chunk(cx, cy);
+				if (chunk.is_uniform() && chunk.value() == empty_cell) { continue; }
+				const size_t bx = cx*chunk_size, by = cy*chunk_size;
+				for (size_t y = std::max(y0, by); y < std::min(y1, by + chunk_size); ++y) {
+					for (size_t x = std::max(x0, bx); x < std::min(x1, bx + chunk_size); ++x) {
+						CellID cid = chunk.get(x - bx, y - by);
+						if (cid == empty_cell) { continue; }
+						const CellInfo* block = current_storage->get(cid);
+						CellContext::Draw(x*cell_size, y*cell_size, block,
+							current_storage->is_dyn(cid) ? l.get_dyn(x, y) : nullptr);
+					}
+				}
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	// nothing to draw in chunk (cx, cy): it and its neighbours, which
+	// may spill into it, are all empty
+	bool blank(Layer& l, size_t cx, size_t cy) {
+		for (size_t y = cy > 0 ? cy - 1 : 0; y <= std::min(cy + 1, l.ChunksY() - 1); ++y) {
+			for (size_t x = cx > 0 ? cx - 1 : 0; x <= std::min(cx + 1, l.ChunksX() - 1); ++x) {
+				const Layer::Chunk& chunk = l.chunk(x, y);
+				if (!chunk.is_uniform() || chunk.value() != empty_cell) { return false; }
+			}
+		}
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////
+	// draws the animated block at cell (x, y) of the tile again: its
+	// frame box is cleared and every cell overlapping it redrawn,
+	// clipped to the box
+	void redraw_animated(Layer& l, size_t x, size_t y, Vector2 origin) {
+		const CellInfoAnimation* anima = current_storage->get(l.get(x, y))->animation;
+		const float left = x*cell_size - anima->frame_w/2.0f;
+		const float top = y*cell_size - anima->frame_h/2.0f;
+		const size_t cx0 = (size_t)std::max(0.0f, floorf(left / cell_size));
+		const size_t cy0 = (size_t)std::max(0.0f, floorf(top / cell_size));
+		const size_t cx1 = std::min(width, (size_t)ceilf((left + anima->frame_w) / cell_size) + 1);
+		const size_t cy1 = std::min(height, (size_t)ceilf((top + anima->frame_h) / cell_size) + 1);
+		BeginScissorMode(floorf(left - origin.x), floorf(top - origin.y),
+			ceilf(anima->frame_w), ceilf(anima->frame_h));
+		ClearBackground(ColorAlpha(BLACK, 0.0f));
+		draw_cells(l, cx0 > 0 ? cx0 - 1 : 0, cy0 > 0 ? cy0 - 1 : 0, cx1, cy1);
+		EndScissorMode();
+	}
+
+	////////////////////////////////////////////////////////////
+	// keeps the tile of chunk (cx, cy) up to date with layer l. The
+	// tile is drawn whole when the chunk changed; when only the
+	// animation clock `advanced`, just the animated blocks on it are
+	// drawn again
+	void update_tile(TileSlot slot, Layer& l, size_t cx, size_t cy, bool advanced) {
+		const uint64_t key = TileCache::Key(slot, cx, cy);
+		if (blank(l, cx, cy)) {
+			tiles.release(key);
+			return;
+		}
+		TileCache::Tile& tile = tiles.acquire(key);
+		bool stale = !tile.drawn || tile.version != l.Version(cx, cy);
+		if (!stale && !advanced) {
+			return;
+		}
+		const size_t x0 = cx*chunk_size, y0 = cy*chunk_size;
+		const size_t x1 = std::min(x0 + chunk_size, width);
+		const size_t y1 = std::min(y0 + chunk_size, height);
+		Camera2D origin = {0};
+		origin.target = (Vector2){(float)x0*cell_size, (float)y0*cell_size};
+		origin.zoom = 1.0f;
+		if (!stale) {
+			/* animated blocks of this chunk and of the neighbours
+			 * whose frames spill into the tile */
+			const float tile_x1 = x1*cell_size, tile_y1 = y1*cell_size;
+			m_redraw.clear();
+			for (size_t ny = cy > 0 ? cy - 1 : 0; ny <= std::min(cy + 1, l.ChunksY() - 1); ++ny) {
+				for (size_t nx = cx > 0 ? cx - 1 : 0; nx <= std::min(cx + 1, l.ChunksX() - 1); ++nx) {
+					for (uint16_t local: l.AnimatedCells(nx, ny)) {
+						const size_t x = nx*chunk_size + local % chunk_size;
+						const size_t y = ny*chunk_size + local / chunk_size;
+						const CellInfoAnimation* anima = current_storage->get(l.get(x, y))->animation;
+						if (x*cell_size + anima->frame_w/2.0f > origin.target.x &&
+							y*cell_size + anima->frame_h/2.0f > origin.target.y &&
+							x*cell_size - anima->frame_w/2.0f < tile_x1 &&
+							y*cell_size - anima->frame_h/2.0f < tile_y1) {
+							m_redraw.emplace_back(x, y);
+						}
+					}
+				}
+			}
+			if (m_redraw.empty()) {
+				return;
+			}
+			/* each one redraws about 3x3 cells: past a few dozen the
+			 * whole tile is cheaper */
+			stale = m_redraw.size()*9 >= (chunk_size + 2)*(chunk_size + 2);
+		}
+		if (!stale) {
+			BeginTextureMode(tile.target);
+			BeginMode2D(origin);
+			for (auto [x, y]: m_redraw) {
+				redraw_animated(l, x, y, origin.target);
+			}
+			EndMode2D();
+			EndTextureMode();
+			return;
+		}
+		BeginTextureMode(tile.target);
+		ClearBackground(ColorAlpha(BLACK, 0.0f));
+		BeginMode2D(origin);
+		/* blocks spill up to a cell over their bounds: the ring of
+		 * neighbour cells is drawn too and clipped by the tile */
+		draw_cells(l, x0 > 0 ? x0 - 1 : 0, y0 > 0 ? y0 - 1 : 0,
+			std::min(x1 + 1, width), std::min(y1 + 1, height));
+		EndMode2D();
+		EndTextureMode();
+		tile.version = l.Version(cx, cy);
+		tile.drawn = true;
+	}
+
+	////////////////////////////////////////////////////////////
+	// chunks under the camera, one chunk of margin around them
+	void update_view(Camera2D& camera) {
+		const float sw = GetScreenWidth(), sh = GetScreenHeight();
+		float x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+		for (Vector2 corner: {(Vector2){0, 0}, (Vector2){sw, 0}, (Vector2){0, sh}, (Vector2){sw, sh}}) {
+			Vector2 p = GetScreenToWorld2D(corner, camera);
+			x0 = std::min(x0, p.x); x1 = std::max(x1, p.x);
+			y0 = std::min(y0, p.y); y1 = std::max(y1, p.y);
+		}
+		/* world pixels, rows counted from the bottom like the tiles are drawn */
+		const Vector2 pos = getPos();
+		const float top = pos.y + height*cell_size;
+		const float tx0 = floorf((x0 - pos.x) / tile_px), tx1 = floorf((x1 - pos.x) / tile_px);
+		const float ty0 = floorf((top - y1) / tile_px), ty1 = floorf((top - y0) / tile_px);
+		const float cw = (width + chunk_size - 1) / chunk_size, ch = (height + chunk_size - 1) / chunk_size;
+		view_x0 = (size_t)mew::clamp(tx0 - 1.0f, 0.0f, cw);
+		view_x1 = (size_t)mew::clamp(tx1 + 2.0f, 0.0f, cw);
+		view_y0 = (size_t)mew::clamp(ty0 - 1.0f, 0.0f, ch);
+		view_y1 = (size_t)mew::clamp(ty1 + 2.0f, 0.0f, ch);
+	}
 public:	
 	World() {}
 	World(size_t width, size_t height): width(width), height(height) {}
@@ -397,16 +908,14 @@ public:
 	void createFloor(CellID fill) {
 		MewUserAssert(fill != -1, "cannot puts empty cell");
 		Layer _floor;
-		_floor.fill(width*height, fill);
+		_floor.fill(width, height, fill);
 		layers.push_back(_floor);
-		r_texture.main = LoadRenderTexture(width*cell_size, height*cell_size);
-		r_texture.sub  = LoadRenderTexture(width*cell_size, height*cell_size);
 	}
 
 	////////////////////////////////////////////////////////////
 	void createLayer() {
 		Layer _floor;
-		_floor.fill(width*height, empty_cell);
+		_floor.fill(width, height, empty_cell);
 		layers.push_back(_floor);
 	}
 
@@ -425,76 +934,120 @@ public:
 	}
 
 	////////////////////////////////////////////////////////////
+	// scatters each cell over the layer, counts[i] of the area, one
+	// chunk job per chunk; later cells cover earlier ones
 	void PutForNoiseLayer(std::initializer_list<CellID> cells, std::initializer_list<double> counts) {
 		Layer& l =	getCurrentLayer();
-		#pragma omp parallel for collapse(2)
-		for (size_t i = 0; i < cells.size(); ++i) {
-			size_t dens = width*height*((counts.begin())[i]);
-			for (uint k = 0; k < dens; ++k) {
-				size_t x = GetRandomValue(0, width);
-				size_t y = GetRandomValue(0, height);
-				l.set(mew::get_index(x, y, width), (cells.begin())[i]);
+		const uint64_t seed = ((uint64_t)GetRandomValue(0, INT_MAX) << 32) ^ (uint64_t)GetRandomValue(0, INT_MAX);
+		GetJobSystem()->for_chunks(l.ChunksX(), l.ChunksY(), [&](size_t cx, size_t cy) {
+			ChunkRandom random(seed, cx, cy);
+			const size_t w = std::min(chunk_size, width - cx*chunk_size);
+			const size_t h = std::min(chunk_size, height - cy*chunk_size);
+			for (size_t i = 0; i < cells.size(); ++i) {
+				/* rounded at random, so small counts still add up over the chunks */
+				const size_t dens = w*h*(counts.begin())[i] + random.unit();
+				for (size_t k = 0; k < dens; ++k) {
+					l.set(cx*chunk_size + random.below(w), cy*chunk_size + random.below(h), (cells.begin())[i]);
+				}
 			}
-		}
+		});
 		should_render = true;
 	}
 
 	////////////////////////////////////////////////////////////
-	RenderTextures& render() {
+	void render(Camera2D& camera) {
+		MewAssert(current_storage != nullptr);
 		if (should_render) {
-			MewAssert(current_storage != nullptr);
-			Layer& l = layers[0];
-			BeginTextureMode(r_texture.main);
-			#pragma omp parallel for collapse(2)
-			for (uint x = 0; x < width; ++x) {
-				for (uint y = 0; y < height; ++y) {
-					size_t index = mew::get_index(x, y, width);
-					CellID cid = l.get(index);
-					CellInfo* block = current_storage->get(cid);
-					CellContext::Draw(x*cell_size, y*cell_size, block);
+			tiles.invalidate(FloorTiles);
+			should_render = false;
+		}
+		if (sub_layer != current_layer) {
+			tiles.invalidate(LayerTiles);
+			sub_layer = current_layer;
+		}
+		update_view(camera);
+		/* one clock for every animated block, whatever the frame rate */
+		const bool advanced = current_storage->animate(GetTime());
+		tiles.beginFrame();
+		for (size_t cy = view_y0; cy < view_y1; ++cy) {
+			for (size_t cx = view_x0; cx < view_x1; ++cx) {
+				update_tile(FloorTiles, layers[0], cx, cy, advanced);
+				if (layers.size() > 1) {
+					update_tile(LayerTiles, getCurrentLayer(), cx, cy, advanced);
 				}
 			}
-			EndTextureMode();
-			should_render = false;
 		}
-		if (layers.size() == 1) { return r_texture; }
+		tiles.trim();
+	}
 
-		Layer& ll = getCurrentLayer();
-		BeginTextureMode(r_texture.sub);
-		ClearBackground(ColorAlpha(BLACK, 0.0f));
-		#pragma omp parallel for collapse(2)
-		for (uint x = 0; x < width; ++x) {
-			for (uint y = 0; y < height; ++y) {
-				size_t index = mew::get_index(x, y, width);
-				CellID cid = ll.get(index);
-				if (cid == empty_cell) { continue; }
-				CellInfo* block = current_storage->get(cid);
-				CellContext::Draw(x*cell_size, y*cell_size, block, ll.get_dyn(index));
+	////////////////////////////////////////////////////////////
+	// tiles of one slot rendered for the current view; render textures
+	// come out flipped, rows are placed bottom up to match
+	void drawTiles(TileSlot slot) {
+		const Vector2 pos = getPos();
+		const Rectangle source = {0, 0, (float)tile_px, (float)tile_px};
+		for (size_t cy = view_y0; cy < view_y1; ++cy) {
+			for (size_t cx = view_x0; cx < view_x1; ++cx) {
+				TileCache::Tile* tile = tiles.find(TileCache::Key(slot, cx, cy));
+				if (tile == nullptr || !tile->drawn) { continue; }
+				Vector2 at = {
+					pos.x + (float)(cx*tile_px),
+					pos.y + (float)(height*cell_size) - (float)((cy + 1)*tile_px)
+				};
+				DrawTextureRec(tile->target.texture, source, at, WHITE);
 			}
 		}
-		EndTextureMode();
-		return r_texture;
 	}
 
 	////////////////////////////////////////////////////////////
-	RenderTextures& getRenderTexture() {
-		return r_texture;
+	// advances the world ticks `dt` seconds cover, then ticks due
+	// blocks of every layer within the frame's budget
+	void tick(float dt) {
+		MewAssert(current_storage != nullptr);
+		tick_clock += dt;
+		/* after a stall the world slows down rather than catching up */
+		for (int i = 0; tick_clock >= tick_time && i < 4; ++i) {
+			tick_clock -= tick_time;
+			for (Layer& l: layers) {
+				l.advance();
+				if (random_ticks == 0) { continue; }
+				GetJobSystem()->for_chunks(l.ChunksX(), l.ChunksY(), [&](size_t cx, size_t cy) {
+					l.random_tick(cx, cy, random_ticks);
+				});
+			}
+		}
+		tick_clock = std::min(tick_clock, tick_time);
+		size_t budget = tick_budget;
+		for (Layer& l: layers) {
+			budget -= l.run_ticks(budget);
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	TileCache& getTiles() {
+		return tiles;
+	}
+
+	////////////////////////////////////////////////////////////
+	// bytes of tile textures kept for chunks out of view
+	void setTileBudget(size_t bytes) {
+		tiles.setBudget(bytes);
 	}
 	
 	////////////////////////////////////////////////////////////
-	void set(size_t x, size_t y, CellID idx, DynCellData data = nullptr) {
-		getCurrentLayer().set(mew::get_index(x, y, width), idx, data);
-		should_render = true;
+	void set(size_t x, size_t y, CellID idx, const DynCellData* data = nullptr) {
+		/* the layer marks the chunk, render() redraws only that */
+		getCurrentLayer().set(x, y, idx, data);
 	}
 
 	////////////////////////////////////////////////////////////
 	void put(size_t x, size_t y, CellID idx) {
-		getCurrentLayer().set(mew::get_index(x, y, width), idx, nullptr);
+		getCurrentLayer().set(x, y, idx, nullptr);
 	}
 	
 	////////////////////////////////////////////////////////////
-	CellID& get(size_t x, size_t y) {
-		return getCurrentLayer().get(mew::get_index(x, y, width));
+	CellID get(size_t x, size_t y) {
+		return getCurrentLayer().get(x, y);
 	}
 	// void dput() {
 
@@ -512,8 +1065,7 @@ public:
 	
 	////////////////////////////////////////////////////////////
 	void clear() {
-		UnloadRenderTexture(r_texture.main);
-		UnloadRenderTexture(r_texture.sub);
+		tiles.clear();
 	}
 };
 
@@ -694,10 +1246,9 @@ public:
 
 	void draw() {
 		MewAssert(current_storage != nullptr);
-		CellInfo* block = current_storage->get(player_cell);
+		const CellInfo* block = current_storage->get(player_cell);
 		MewUserAssert(block != nullptr, "cannot load player texture");
-		block->rotation = body.rotation;
-		CellContext::Draw(position.x, position.y, block);
+		CellContext::DrawRotated(position.x, position.y, block, body.rotation);
 	}
 };
 
@@ -733,7 +1284,6 @@ public:
 		bool has_touches;
 		Vector2 cell_pos = GetCellPosByMouse(p.camera, w, &has_touches);
 		if (!has_touches) { return; }
-		CellInfo* block = current_storage->get(p.current_block);
 		floor_particle_system->spawn("put_block", (vec2){cell_pos.x*cell_size, (cell_pos.y-1)*cell_size}, 8.0f);
 		cell_pos.y = w.height - cell_pos.y;
 		w.put(cell_pos.x, cell_pos.y, p.current_block);
@@ -743,7 +1293,6 @@ public:
 		bool has_touches;
 		Vector2 cell_pos = GetCellPosByMouse(p.camera, w, &has_touches);
 		if (!has_touches) { return; }
-		CellInfo* block = current_storage->get(p.current_block);
 		floor_particle_system->spawn("destroy_block", (vec2){cell_pos.x*cell_size, (cell_pos.y-1)*cell_size}, 7.0f);
 		cell_pos.y = w.height - cell_pos.y;
 		w.put(cell_pos.x, cell_pos.y, empty_cell);
@@ -760,16 +1309,15 @@ public:
 		floor_particle_system->update();
 	}
 	
-	static void Render(World& w) {
-		w.render();
+	static void Render(World& w, Camera2D& camera) {
+		w.render(camera);
 	}
 
 	static void Draw(World& w) {
 		MewAssert(floor_particle_system != nullptr);
-		auto _texture = w.getRenderTexture();
-		DrawTextureRec(_texture.main.texture, w.getRect(), w.getPos(), WHITE);
+		w.drawTiles(World::FloorTiles);
 		floor_particle_system->render(w.getPos());
-		DrawTextureRec(_texture.sub.texture, w.getRect(), w.getPos(), WHITE);
+		w.drawTiles(World::LayerTiles);
 		if (top_particle_system != nullptr) {
 			top_particle_system->render(w.getPos());
 		}
@@ -0,0 +1,147 @@
+#ifndef ANSI_TERMINAL_SO2U
+#define ANSI_TERMINAL_SO2U
+
+#include <algorithm>
+#include <ostream>
+#include <vector>
+#include "mewall.h"
+
+namespace mew::game {
+	// Diffing ANSI/VT100 frame writer.
+	// Keeps the last frame that reached the terminal and, for the next
+	// one, emits only cursor moves plus the cells that changed. Output is
+	// staged in a buffer sized for the worst case once per resize, so a
+	// frame costs a single write and flush whatever the board size.
+	class AnsiTerminal {
+	private:
+		size_t width = 0U, height = 0U;
+		std::vector<char> front;
+		std::vector<char> buffer;
+		size_t used = 0U;
+		size_t cursor_x = 0U, cursor_y = 0U;
+		bool repaint = true;
+
+		/* re-sending this many unchanged cells is cheaper than a CSI move */
+		static constexpr size_t max_skip = 4U;
+
+		////////////////////////////////////////////////////////////
+		void put(char c) noexcept {
+			buffer[used++] = c;
+		}
+
+		////////////////////////////////////////////////////////////
+		void put(const char* str) noexcept {
+			while (*str) { buffer[used++] = *str++; }
+		}
+
+		////////////////////////////////////////////////////////////
+		void number(size_t value) noexcept {
+			char digits[24];
+			size_t n = 0U;
+			do {
+				digits[n++] = (char)('0' + value % 10U);
+				value /= 10U;
+			} while (value != 0U);
+			while (n > 0) { buffer[used++] = digits[--n]; }
+		}
+
+		////////////////////////////////////////////////////////////
+		// CSI row;col H (1-based)
+		void move(size_t x, size_t y) noexcept {
+			put("\x1b[");
+			number(y + 1);
+			put(';');
+			number(x + 1);
+			put('H');
+			cursor_x = x;
+			cursor_y = y;
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		AnsiTerminal() {}
+
+		////////////////////////////////////////////////////////////
+		AnsiTerminal(size_t _w, size_t _h) {
+			resize(_w, _h);
+		}
+
+		////////////////////////////////////////////////////////////
+		void resize(size_t _w, size_t _h) {
+			width = _w;
+			height = _h;
+			front.assign(width*height, 0);
+			/* worst case: every cell changed, each behind its own move */
+			size_t digits = 1U;
+			for (size_t v = (width > height ? width : height) + 1; v >= 10U; v /= 10U) { ++digits; }
+			size_t per_cell = 1U + std::max<size_t>(max_skip, 4U + 2U*digits);
+			buffer.assign(width*height*per_cell + 2U*digits + 64U, 0);
+			repaint = true;
+		}
+
+		////////////////////////////////////////////////////////////
+		// next present() redraws everything (e.g. after the screen was
+		// scrolled or cleared by someone else)
+		void invalidate() noexcept {
+			repaint = true;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return width;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return height;
+		}
+
+		////////////////////////////////////////////////////////////
+		// glyph(x, y) -> char for every cell; returns the bytes sent
+		template<typename Glyph>
+		size_t present(std::ostream& out, Glyph&& glyph) {
+			used = 0U;
+			if (repaint) {
+				/* hide cursor, clear screen */
+				put("\x1b[?25l\x1b[2J");
+				std::fill(front.begin(), front.end(), 0);
+				move(0, 0);
+				repaint = false;
+			}
+			for (size_t y = 0; y < height; ++y) {
+				char* prev = front.data() + y*width;
+				for (size_t x = 0; x < width; ++x) {
+					char c = glyph(x, y);
+					if (c == prev[x]) { continue; }
+					if (cursor_y != y || x < cursor_x || x - cursor_x > max_skip) {
+						move(x, y);
+					} else {
+						/* short gap: resend the unchanged cells */
+						for (size_t k = cursor_x; k < x; ++k) { put(prev[k]); }
+					}
+					put(c);
+					prev[x] = c;
+					cursor_x = x + 1;
+				}
+			}
+			if (used > 0U) {
+				out.write(buffer.data(), (std::streamsize)used);
+				out.flush();
+			}
+			return used;
+		}
+
+		////////////////////////////////////////////////////////////
+		// cursor below the board and visible again
+		void restore(std::ostream& out) {
+			used = 0U;
+			move(0, height);
+			put("\x1b[?25h");
+			out.write(buffer.data(), (std::streamsize)used);
+			out.flush();
+			repaint = true;
+		}
+	};
+}
+
+#endif
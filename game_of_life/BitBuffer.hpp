@@ -0,0 +1,344 @@
+#ifndef BIT_BUFFER_SO2U
+#define BIT_BUFFER_SO2U
+
+#include "mewall.h"
+#include "Rule.hpp"
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+namespace mew::game {
+	namespace bits {
+		typedef uint64_t word_t;
+		constexpr size_t word_bits = 64U;
+
+#if defined(__AVX2__)
+		typedef uint64_t lane_t __attribute__((vector_size(32)));
+#elif defined(__SSE2__)
+		typedef uint64_t lane_t __attribute__((vector_size(16)));
+#else
+		typedef uint64_t lane_t;
+#endif
+		constexpr size_t lane_words = sizeof(lane_t) / sizeof(word_t);
+
+		////////////////////////////////////////////////////////////
+		inline lane_t load(const word_t* ptr) {
+			lane_t v;
+			memcpy(&v, ptr, sizeof(lane_t));
+			return v;
+		}
+
+		////////////////////////////////////////////////////////////
+		inline void store(word_t* ptr, lane_t v) {
+			memcpy(ptr, &v, sizeof(lane_t));
+		}
+
+		////////////////////////////////////////////////////////////
+		// B3/S23 on 64 (or lane_words*64) cells at once.
+		// Each argument holds one neighbor direction for every cell;
+		// the eight neighbors are summed with bit-sliced full adders
+		// and the cell is alive when count==3 or (count==2 && alive).
+		template<typename W>
+		inline W LifeWord(
+			W up_w, W up, W up_e,
+			W md_w, W md, W md_e,
+			W dn_w, W dn, W dn_e
+		) {
+			W t0 = up_w ^ up ^ up_e;
+			W t1 = (up_w & up) | (up_e & (up_w ^ up));
+			W m0 = md_w ^ md_e;
+			W m1 = md_w & md_e;
+			W u0 = dn_w ^ dn ^ dn_e;
+			W u1 = (dn_w & dn) | (dn_e & (dn_w ^ dn));
+			/* ones */
+			W s0 = t0 ^ m0 ^ u0;
+			W c0 = (t0 & m0) | (u0 & (t0 ^ m0));
+			/* twos: exactly one of t1, m1, u1, c0 */
+			W p = t1 ^ m1 ^ u1;
+			W q = (t1 & m1) | (u1 & (t1 ^ m1));
+			return ~q & (p ^ c0) & (s0 | md);
+		}
+
+		////////////////////////////////////////////////////////////
+		template<size_t N, typename W>
+		inline W CountEquals(W n0, W n1, W n2, W n3) {
+			W e0 = (N & 1) ? n0 : ~n0;
+			W e1 = (N & 2) ? n1 : ~n1;
+			W e2 = (N & 4) ? n2 : ~n2;
+			W e3 = (N & 8) ? n3 : ~n3;
+			return e0 & e1 & e2 & e3;
+		}
+
+		////////////////////////////////////////////////////////////
+		// cells whose count is in Mask; the fold only emits the
+		// comparisons for counts the rule actually uses
+		template<uint32_t Mask, typename W, size_t... N>
+		inline W CountIn(W n0, W n1, W n2, W n3, std::index_sequence<N...>) {
+			W r = n0 ^ n0;
+			((r = ((Mask >> N) & 1U) ? (r | CountEquals<N>(n0, n1, n2, n3)) : r), ...);
+			return r;
+		}
+
+		////////////////////////////////////////////////////////////
+		// any two-state B/S rule: the same adders produce the full 4-bit
+		// neighbor count and the rule masks pick matching cells
+		template<typename Rule, typename W>
+		inline W RuleWord(
+			W up_w, W up, W up_e,
+			W md_w, W md, W md_e,
+			W dn_w, W dn, W dn_e
+		) {
+			static_assert(Rule::states == 2 && Rule::radius == 1,
+				"bit-packed boards only run two-state radius-1 rules");
+			if constexpr (Rule::birth == rules::Life::birth && Rule::survive == rules::Life::survive) {
+				return LifeWord<W>(up_w, up, up_e, md_w, md, md_e, dn_w, dn, dn_e);
+			} else {
+				W t0 = up_w ^ up ^ up_e;
+				W t1 = (up_w & up) | (up_e & (up_w ^ up));
+				W m0 = md_w ^ md_e;
+				W m1 = md_w & md_e;
+				W u0 = dn_w ^ dn ^ dn_e;
+				W u1 = (dn_w & dn) | (dn_e & (dn_w ^ dn));
+				W n0 = t0 ^ m0 ^ u0;
+				W c0 = (t0 & m0) | (u0 & (t0 ^ m0));
+				W p = t1 ^ m1 ^ u1;
+				W q = (t1 & m1) | (u1 & (t1 ^ m1));
+				W n1 = p ^ c0;
+				W r = p & c0;
+				W n2 = q ^ r;
+				W n3 = q & r;
+				auto counts = std::make_index_sequence<9>();
+				return (~md & CountIn<Rule::birth>(n0, n1, n2, n3, counts))
+					| (md & CountIn<Rule::survive>(n0, n1, n2, n3, counts));
+			}
+		}
+
+		// One row of the next generation of a torus `width` cells wide,
+		// rows packed into `stride` words; shared by every bit-packed board.
+		template<typename Rule>
+		class RowKernel {
+		private:
+			size_t width = 0U, stride = 0U;
+			word_t last_mask = ~(word_t)0;
+
+			////////////////////////////////////////////////////////////
+			// west: cell x receives x-1, east: cell x receives x+1 (torus)
+			word_t west(const word_t* row, size_t i) const noexcept {
+				word_t carry = (i == 0)
+					? (row[stride-1] >> ((width-1) % word_bits)) & 1U
+					: row[i-1] >> 63;
+				return (row[i] << 1) | carry;
+			}
+
+			////////////////////////////////////////////////////////////
+			word_t east(const word_t* row, size_t i) const noexcept {
+				word_t carry = (i == stride-1)
+					? (row[0] & 1U) << ((width-1) % word_bits)
+					: row[i+1] << 63;
+				return (row[i] >> 1) | carry;
+			}
+
+			////////////////////////////////////////////////////////////
+			word_t stepWord(const word_t* up, const word_t* md, const word_t* dn, size_t i) const noexcept {
+				word_t next = RuleWord<Rule, word_t>(
+					west(up, i), up[i], east(up, i),
+					west(md, i), md[i], east(md, i),
+					west(dn, i), dn[i], east(dn, i)
+				);
+				return (i == stride-1)? (next & last_mask): next;
+			}
+
+		public:
+			////////////////////////////////////////////////////////////
+			RowKernel() {}
+
+			////////////////////////////////////////////////////////////
+			RowKernel(size_t _w): width(_w), stride((_w + word_bits - 1) / word_bits) {
+				size_t tail = width % word_bits;
+				last_mask = tail == 0 ? ~(word_t)0 : (((word_t)1 << tail) - 1);
+			}
+
+			////////////////////////////////////////////////////////////
+			size_t Stride() const noexcept {
+				return stride;
+			}
+
+			////////////////////////////////////////////////////////////
+			// valid bits of the last word of a row
+			word_t LastMask() const noexcept {
+				return last_mask;
+			}
+
+			////////////////////////////////////////////////////////////
+			void operator()(const word_t* up, const word_t* md, const word_t* dn, word_t* out) const noexcept {
+				out[0] = stepWord(up, md, dn, 0);
+				size_t i = 1;
+				if constexpr (lane_words > 1) {
+					for (; i + lane_words < stride; i += lane_words) {
+						lane_t u = load(up+i), m = load(md+i), d = load(dn+i);
+						lane_t up_w = (u << 1) | (load(up+i-1) >> 63);
+						lane_t up_e = (u >> 1) | (load(up+i+1) << 63);
+						lane_t md_w = (m << 1) | (load(md+i-1) >> 63);
+						lane_t md_e = (m >> 1) | (load(md+i+1) << 63);
+						lane_t dn_w = (d << 1) | (load(dn+i-1) >> 63);
+						lane_t dn_e = (d >> 1) | (load(dn+i+1) << 63);
+						store(out+i, RuleWord<Rule, lane_t>(
+							up_w, u, up_e, md_w, m, md_e, dn_w, d, dn_e));
+					}
+				}
+				for (; i < stride; ++i) {
+					out[i] = stepWord(up, md, dn, i);
+				}
+			}
+		};
+	}
+
+	// Bit-packed Life board, 64 cells per word, rows padded to whole words.
+	// Mirrors the DoubleBuffer2d get/set/apply view so it can be used
+	// anywhere a DoubleBuffer2d<byte> is rendered.
+	template<typename Rule = rules::Life>
+	class BasicBitBuffer2d {
+	public:
+		typedef bits::word_t word_t;
+	private:
+		size_t width = 0U, height = 0U, stride = 0U;
+		word_t last_mask = ~(word_t)0;
+		bits::RowKernel<Rule> kernel;
+		std::vector<word_t> _main_buffer;
+		std::vector<word_t> _sub_buffer;
+
+	public:
+		////////////////////////////////////////////////////////////
+		BasicBitBuffer2d() {}
+
+		////////////////////////////////////////////////////////////
+		BasicBitBuffer2d(size_t _w, size_t _h)
+			: width(_w), height(_h),
+			stride((_w + bits::word_bits - 1) / bits::word_bits),
+			kernel(_w), _main_buffer(stride*_h, 0U), _sub_buffer(stride*_h, 0U) {
+			MewUserAssert(_w > 0 && _h > 0, "empty board");
+			last_mask = kernel.LastMask();
+		}
+
+		////////////////////////////////////////////////////////////
+		void clear(byte val) {
+			for (size_t y = 0; y < height; ++y) {
+				for (size_t i = 0; i < stride; ++i) {
+					word_t w = val ? ~(word_t)0 : (word_t)0;
+					if (i == stride-1) { w &= last_mask; }
+					_main_buffer[y*stride+i] = w;
+					_sub_buffer[y*stride+i] = w;
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t size() const noexcept {
+			return width*height;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return width;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return height;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Stride() const noexcept {
+			return stride;
+		}
+
+		////////////////////////////////////////////////////////////
+		word_t LastMask() const noexcept {
+			return last_mask;
+		}
+
+		////////////////////////////////////////////////////////////
+		const word_t* row(size_t y) const noexcept {
+			return _main_buffer.data() + y*stride;
+		}
+
+		////////////////////////////////////////////////////////////
+		word_t* row(size_t y) noexcept {
+			return _main_buffer.data() + y*stride;
+		}
+
+		////////////////////////////////////////////////////////////
+		word_t* sub_row(size_t y) noexcept {
+			return _sub_buffer.data() + y*stride;
+		}
+
+		////////////////////////////////////////////////////////////
+		void set(size_t x, size_t y, byte val) {
+			x %= width; y %= height;
+			word_t& w = _sub_buffer[y*stride + x/bits::word_bits];
+			word_t bit = (word_t)1 << (x % bits::word_bits);
+			w = val ? (w | bit) : (w & ~bit);
+		}
+
+		////////////////////////////////////////////////////////////
+		byte get(size_t x, size_t y) const {
+			x %= width; y %= height;
+			word_t w = _main_buffer[y*stride + x/bits::word_bits];
+			return (byte)((w >> (x % bits::word_bits)) & 1U);
+		}
+
+		////////////////////////////////////////////////////////////
+		void sync() {
+			_sub_buffer = _main_buffer;
+		}
+
+		////////////////////////////////////////////////////////////
+		void apply() {
+			_main_buffer = _sub_buffer;
+		}
+
+		////////////////////////////////////////////////////////////
+		void swap() noexcept {
+			std::swap(_main_buffer, _sub_buffer);
+		}
+
+		////////////////////////////////////////////////////////////
+		// writes next generation of rows [y0, y1) into the sub buffer
+		void stepRows(size_t y0, size_t y1) {
+			for (size_t y = y0; y < y1; ++y) {
+				const word_t* up = row((y + height - 1) % height);
+				const word_t* md = row(y);
+				const word_t* dn = row((y + 1) % height);
+				stepRow(up, md, dn, sub_row(y));
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// one row of the next generation from three source rows
+		void stepRow(const word_t* up, const word_t* md, const word_t* dn, word_t* out) const noexcept {
+			kernel(up, md, dn, out);
+		}
+
+		////////////////////////////////////////////////////////////
+		// advances the board one generation; the sub buffer is left
+		// holding the previous generation, call sync() before staging edits
+		void step() {
+			stepRows(0, height);
+			swap();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t population() const noexcept {
+			size_t counter = 0U;
+			for (word_t w: _main_buffer) {
+				counter += __builtin_popcountll(w);
+			}
+			return counter;
+		}
+	};
+
+	typedef BasicBitBuffer2d<rules::Life> BitBuffer2d;
+}
+
+#endif
@@ -0,0 +1,316 @@
+#ifndef BLOCKED_LIFE_SO2U
+#define BLOCKED_LIFE_SO2U
+
+#include "mewall.h"
+#include "BitBuffer.hpp"
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mew::game {
+	// BitBuffer2d stepped with temporal blocking: the board is cut into
+	// TileWords x TileRows tiles, each tile is copied together with a
+	// depth-cell halo into a small local board, advanced depth
+	// generations there while it stays in cache, and only its interior is
+	// written back. The halo absorbs the error that creeps in from the
+	// local edges (one cell per generation), so the result matches depth
+	// single steps bit for bit while the full board is swept once per
+	// depth generations instead of once per generation.
+	// One step() is one pass: it advances Depth() generations. Tiles
+	// only read the front buffer and write their own cells of the back
+	// one, so a pool of threads takes them off a shared counter, each
+	// with its own local board; the last one to finish swaps buffers.
+	template<typename Rule = rules::Life, size_t TileWords = 128, size_t TileRows = 64>
+	class BasicBlockedLife {
+	public:
+		typedef bits::word_t word_t;
+		static constexpr size_t max_depth = 64U;
+
+	private:
+		struct Scratch {
+			std::vector<word_t> local, local_next;
+		};
+
+		struct SwapBuffers {
+			BasicBitBuffer2d<Rule>* board;
+			void operator()() noexcept { board->swap(); }
+		};
+
+		BasicBitBuffer2d<Rule> board;
+		size_t depth = 1U;
+		uint64_t generation = 0U;
+		size_t thread_count = 1U;
+		std::vector<Scratch> scratch;      /* one per thread */
+		std::vector<std::thread> workers;
+		std::unique_ptr<std::barrier<>> start_barrier;
+		std::unique_ptr<std::barrier<SwapBuffers>> done_barrier;
+		std::atomic<size_t> next_tile{0U};
+		std::atomic<bool> stopping{false};
+
+		////////////////////////////////////////////////////////////
+		size_t tiles_x() const noexcept {
+			return (board.Stride() + TileWords - 1) / TileWords;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t tiles_y() const noexcept {
+			return (board.Height() + TileRows - 1) / TileRows;
+		}
+
+		////////////////////////////////////////////////////////////
+		// 64 cells starting at cell x of a torus row; plain word reads
+		// inside the board, bit pieces where the row wraps
+		word_t fetch(const word_t* row, ptrdiff_t x) const noexcept {
+			const ptrdiff_t w = (ptrdiff_t)board.Width();
+			if (x >= 0 && x + (ptrdiff_t)bits::word_bits <= w) {
+				const size_t at = (size_t)x / bits::word_bits, shift = (size_t)x % bits::word_bits;
+				if (shift == 0U) { return row[at]; }
+				return (row[at] >> shift) | (row[at+1] << (bits::word_bits - shift));
+			}
+			word_t out = 0U;
+			size_t got = 0U, xs = (size_t)(((x % w) + w) % w);
+			while (got < bits::word_bits) {
+				const size_t shift = xs % bits::word_bits;
+				size_t n = std::min({bits::word_bits - got, bits::word_bits - shift, (size_t)w - xs});
+				word_t piece = row[xs / bits::word_bits] >> shift;
+				if (n < bits::word_bits) { piece &= ((word_t)1 << n) - 1U; }
+				out |= piece << got;
+				got += n;
+				xs += n;
+				if (xs == (size_t)w) { xs = 0U; }
+			}
+			return out;
+		}
+
+		////////////////////////////////////////////////////////////
+		void step_tile(size_t tx, size_t ty, Scratch& own) {
+			std::vector<word_t>& local = own.local;
+			std::vector<word_t>& local_next = own.local_next;
+			const size_t stride = board.Stride(), h = board.Height();
+			const size_t halo_words = (depth + bits::word_bits - 1) / bits::word_bits;
+			const size_t i0 = tx*TileWords, i1 = std::min(i0 + TileWords, stride);
+			const size_t y0 = ty*TileRows, y1 = std::min(y0 + TileRows, h);
+			const size_t lw = (i1 - i0) + 2U*halo_words;
+			const size_t rows = (y1 - y0) + 2U*depth;
+			local.resize(lw*rows);
+			local_next.resize(lw*rows);
+			auto x_of = [&](size_t j) {
+				return ((ptrdiff_t)(i0 + j) - (ptrdiff_t)halo_words)*(ptrdiff_t)bits::word_bits;
+			};
+			const size_t full_words = board.Width() / bits::word_bits;
+			const size_t j0 = std::min(lw, halo_words > i0 ? halo_words - i0 : 0U);
+			const size_t j1 = std::max(j0, std::min(lw, full_words + halo_words > i0 ? full_words + halo_words - i0 : 0U));
+			/* tile + halo, unrolled from the torus */
+			for (size_t r = 0; r < rows; ++r) {
+				const size_t y = (y0 + h*((depth + h - 1) / h) + r - depth) % h;
+				const word_t* src = board.row(y);
+				word_t* dst = local.data() + r*lw;
+				/* whole words inside the row are copied, the wrapping ends assembled */
+				std::copy(src + (i0 + j0 - halo_words), src + (i0 + j1 - halo_words), dst + j0);
+				for (size_t j = 0; j < j0; ++j) {
+					dst[j] = fetch(src, x_of(j));
+				}
+				for (size_t j = j1; j < lw; ++j) {
+					dst[j] = fetch(src, x_of(j));
+				}
+			}
+			/* the local rows wrap on themselves, the halo soaks that up */
+			bits::RowKernel<Rule> kernel(lw*bits::word_bits);
+			for (size_t g = 1; g <= depth; ++g) {
+				for (size_t r = g; r < rows - g; ++r) {
+					kernel(local.data() + (r-1)*lw, local.data() + r*lw,
+						local.data() + (r+1)*lw, local_next.data() + r*lw);
+				}
+				local.swap(local_next);
+			}
+			for (size_t y = y0; y < y1; ++y) {
+				const word_t* src = local.data() + (y - y0 + depth)*lw + halo_words;
+				word_t* dst = board.sub_row(y) + i0;
+				std::copy_n(src, i1 - i0, dst);
+				if (i1 == stride) { dst[i1 - i0 - 1] &= board.LastMask(); }
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// tiles until the counter runs out, then waits for the others
+		void run_tiles(size_t self) {
+			const size_t count = tiles_x()*tiles_y();
+			for (size_t t = next_tile++; t < count; t = next_tile++) {
+				step_tile(t % tiles_x(), t / tiles_x(), scratch[self]);
+			}
+			done_barrier->arrive_and_wait();
+		}
+
+		////////////////////////////////////////////////////////////
+		void worker(size_t self) {
+			for (;;) {
+				start_barrier->arrive_and_wait();
+				if (stopping.load(std::memory_order_acquire)) { return; }
+				run_tiles(self);
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		void start_pool() {
+			scratch.assign(thread_count, Scratch());
+			if (thread_count <= 1) { return; }
+			stopping = false;
+			start_barrier = std::make_unique<std::barrier<>>(thread_count);
+			done_barrier = std::make_unique<std::barrier<SwapBuffers>>(
+				thread_count, SwapBuffers{&board});
+			/* thread 0 is the caller */
+			for (size_t i = 1; i < thread_count; ++i) {
+				workers.emplace_back(&BasicBlockedLife::worker, this, i);
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		void stop_pool() {
+			if (workers.empty()) { return; }
+			stopping = true;
+			start_barrier->arrive_and_wait();
+			for (std::thread& t: workers) {
+				t.join();
+			}
+			workers.clear();
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		BasicBlockedLife() {
+			scratch.resize(1U);
+		}
+
+		////////////////////////////////////////////////////////////
+		BasicBlockedLife(size_t _w, size_t _h, size_t _depth = 1U, size_t _threads = 0U): board(_w, _h) {
+			setDepth(_depth);
+			setThreads(_threads);
+		}
+
+		////////////////////////////////////////////////////////////
+		~BasicBlockedLife() {
+			stop_pool();
+		}
+
+		BasicBlockedLife(const BasicBlockedLife&) = delete;
+		BasicBlockedLife& operator=(const BasicBlockedLife&) = delete;
+
+		////////////////////////////////////////////////////////////
+		// 0 picks one thread per hardware core
+		void setThreads(size_t count) {
+			stop_pool();
+			if (count == 0) {
+				count = std::max<size_t>(1U, std::thread::hardware_concurrency());
+			}
+			thread_count = std::min(count, std::max<size_t>(1U, tiles_x()*tiles_y()));
+			start_pool();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Threads() const noexcept {
+			return thread_count;
+		}
+
+		////////////////////////////////////////////////////////////
+		// generations per pass, 1..max_depth
+		void setDepth(size_t _depth) {
+			depth = std::clamp<size_t>(_depth, 1U, max_depth);
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Depth() const noexcept {
+			return depth;
+		}
+
+		////////////////////////////////////////////////////////////
+		void clear(byte val) {
+			board.clear(val);
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return board.Width();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return board.Height();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Stride() const noexcept {
+			return board.Stride();
+		}
+
+		////////////////////////////////////////////////////////////
+		const word_t* row(size_t y) const noexcept {
+			return board.row(y);
+		}
+
+		////////////////////////////////////////////////////////////
+		void set(size_t x, size_t y, byte val) {
+			board.set(x, y, val);
+		}
+
+		////////////////////////////////////////////////////////////
+		byte get(size_t x, size_t y) const {
+			return board.get(x, y);
+		}
+
+		////////////////////////////////////////////////////////////
+		void sync() {
+			board.sync();
+		}
+
+		////////////////////////////////////////////////////////////
+		void apply() {
+			board.apply();
+		}
+
+		////////////////////////////////////////////////////////////
+		// Depth() generations in one sweep of the board
+		void step() {
+			generation += depth;
+			if (thread_count <= 1) {
+				for (size_t ty = 0; ty < tiles_y(); ++ty) {
+					for (size_t tx = 0; tx < tiles_x(); ++tx) {
+						step_tile(tx, ty, scratch[0]);
+					}
+				}
+				board.swap();
+				return;
+			}
+			next_tile.store(0U, std::memory_order_relaxed);
+			start_barrier->arrive_and_wait();
+			run_tiles(0);
+		}
+
+		////////////////////////////////////////////////////////////
+		uint64_t Generation() const noexcept {
+			return generation;
+		}
+
+		////////////////////////////////////////////////////////////
+		void setGeneration(uint64_t _generation) noexcept {
+			generation = _generation;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t population() const noexcept {
+			return board.population();
+		}
+
+		////////////////////////////////////////////////////////////
+		const BasicBitBuffer2d<Rule>& Board() const noexcept {
+			return board;
+		}
+	};
+
+	typedef BasicBlockedLife<rules::Life> BlockedLife;
+}
+
+#endif
@@ -0,0 +1,646 @@
+#ifndef CENSUS_SO2U
+#define CENSUS_SO2U
+
+#include "mewall.h"
+#include "Rule.hpp"
+#include "Hash.hpp"
+#include "Engines.hpp"
+#include "Cycle.hpp"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace mew::game {
+	namespace census {
+		struct Cell {
+			int x, y;
+
+			////////////////////////////////////////////////////////////
+			bool operator<(const Cell& other) const noexcept {
+				return y != other.y ? y < other.y : x < other.x;
+			}
+
+			////////////////////////////////////////////////////////////
+			bool operator==(const Cell& other) const noexcept {
+				return x == other.x && y == other.y;
+			}
+		};
+
+		typedef std::vector<Cell> Shape;
+
+		////////////////////////////////////////////////////////////
+		// moves the shape to the origin and sorts it; returns the offset
+		inline Cell Normalize(Shape& shape) {
+			Cell low = {INT_MAX, INT_MAX};
+			for (const Cell& c: shape) {
+				low.x = std::min(low.x, c.x);
+				low.y = std::min(low.y, c.y);
+			}
+			for (Cell& c: shape) {
+				c.x -= low.x;
+				c.y -= low.y;
+			}
+			std::sort(shape.begin(), shape.end());
+			return low;
+		}
+
+		////////////////////////////////////////////////////////////
+		// king-move connected parts of a shape
+		inline std::vector<Shape> Pieces(const Shape& shape) {
+			std::vector<Shape> out;
+			std::vector<bool> taken(shape.size(), false);
+			std::vector<size_t> stack;
+			for (size_t i = 0; i < shape.size(); ++i) {
+				if (taken[i]) { continue; }
+				out.emplace_back();
+				taken[i] = true;
+				stack.assign(1U, i);
+				while (!stack.empty()) {
+					const Cell c = shape[stack.back()];
+					stack.pop_back();
+					out.back().push_back(c);
+					for (size_t j = 0; j < shape.size(); ++j) {
+						if (taken[j] || std::abs(shape[j].x - c.x) > 1 || std::abs(shape[j].y - c.y) > 1) { continue; }
+						taken[j] = true;
+						stack.push_back(j);
+					}
+				}
+			}
+			return out;
+		}
+
+		////////////////////////////////////////////////////////////
+		// king-move distance between the closest cells of two shapes
+		inline int Distance(const Shape& a, const Shape& b) {
+			int best = INT_MAX;
+			for (const Cell& p: a) {
+				for (const Cell& q: b) {
+					best = std::min(best, std::max(std::abs(p.x - q.x), std::abs(p.y - q.y)));
+				}
+			}
+			return best;
+		}
+
+		////////////////////////////////////////////////////////////
+		// one of the 8 symmetries of the square, normalized
+		inline Shape Orient(const Shape& shape, int o) {
+			Shape out(shape.size());
+			for (size_t i = 0; i < shape.size(); ++i) {
+				int x = shape[i].x, y = shape[i].y;
+				if (o & 4) { std::swap(x, y); }
+				if (o & 1) { x = -x; }
+				if (o & 2) { y = -y; }
+				out[i] = (Cell){x, y};
+			}
+			Normalize(out);
+			return out;
+		}
+
+		////////////////////////////////////////////////////////////
+		// extended Wechsler format: strips of 5 rows, one base-32 digit
+		// per column, runs of blank columns as w/x/y, strips split by z
+		inline std::string Wechsler(const Shape& shape) {
+			static const char digits[] = "0123456789abcdefghijklmnopqrstuv";
+			/* y counts 4..39 blank columns, so it needs 36 symbols */
+			static const char runs[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+			int w = 0, h = 0;
+			for (const Cell& c: shape) {
+				w = std::max(w, c.x + 1);
+				h = std::max(h, c.y + 1);
+			}
+			std::vector<byte> columns((size_t)w*((h + 4) / 5), 0);
+			for (const Cell& c: shape) {
+				columns[(size_t)(c.y / 5)*w + c.x] |= (byte)(1U << (c.y % 5));
+			}
+			std::string out;
+			for (int s = 0; s*5 < h; ++s) {
+				if (s > 0) { out += 'z'; }
+				int blank = 0;
+				for (int x = 0; x < w; ++x) {
+					byte v = columns[(size_t)s*w + x];
+					if (v == 0) {
+						++blank;
+						continue;
+					}
+					while (blank > 0) {
+						if (blank == 1) { out += '0'; blank = 0; }
+						else if (blank == 2) { out += 'w'; blank = 0; }
+						else if (blank == 3) { out += 'x'; blank = 0; }
+						else {
+							int run = std::min(blank, 39);
+							out += 'y';
+							out += runs[run - 4];
+							blank -= run;
+						}
+					}
+					out += digits[v];
+				}
+			}
+			return out;
+		}
+
+		////////////////////////////////////////////////////////////
+		// live cells of an engine; bit boards are scanned a word at a time
+		template<typename Engine>
+		void Capture(Engine& engine, Shape& out) {
+			out.clear();
+			if constexpr (requires { engine.Stride(); engine.row(0); }) {
+				for (size_t y = 0; y < engine.Height(); ++y) {
+					const auto* row = engine.row(y);
+					for (size_t i = 0; i < engine.Stride(); ++i) {
+						for (uint64_t w = row[i]; w != 0U; w &= w - 1U) {
+							out.push_back((Cell){(int)(i*64U + (size_t)__builtin_ctzll(w)), (int)y});
+						}
+					}
+				}
+			} else {
+				for (size_t y = 0; y < engine.Height(); ++y) {
+					for (size_t x = 0; x < engine.Width(); ++x) {
+						if (!IsDead(engine.get(x, y))) { out.push_back((Cell){(int)x, (int)y}); }
+					}
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// shortest, then smallest encoding over every phase and symmetry
+		inline std::string Canonical(const std::vector<Shape>& phases) {
+			std::string best;
+			for (const Shape& phase: phases) {
+				for (int o = 0; o < 8; ++o) {
+					std::string code = Wechsler(Orient(phase, o));
+					if (best.empty() || code.size() < best.size() ||
+						(code.size() == best.size() && code < best)) {
+						best = code;
+					}
+				}
+			}
+			return best;
+		}
+	}
+
+	struct CensusOptions {
+		size_t soups = 10000U;
+		size_t threads = 0U;       /* 0 = one per core */
+		uint64_t seed = 1U;
+		size_t board = 256U;       /* torus side */
+		size_t soup = 16U;         /* random square in the middle */
+		size_t max_generations = 20000U;
+		size_t band = 16U;         /* border where spaceships are caught */
+		size_t sweep = 8U;         /* generations between border sweeps */
+	};
+
+	// Object counts of a census; reports of several threads merge.
+	struct CensusReport {
+		uint64_t soups = 0U;
+		uint64_t unstable = 0U;    /* no period within max_generations */
+		uint64_t generations = 0U;
+		double seconds = 0.0;
+		size_t threads = 1U;
+		std::map<std::string, uint64_t> objects;
+
+		////////////////////////////////////////////////////////////
+		void merge(const CensusReport& other) {
+			soups += other.soups;
+			unstable += other.unstable;
+			generations += other.generations;
+			for (const auto& [code, count]: other.objects) {
+				objects[code] += count;
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// still lifes, oscillators and spaceships, most common first
+		void print(FILE* out) const {
+			std::vector<std::pair<std::string, uint64_t>> sorted(objects.begin(), objects.end());
+			std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+				return a.second > b.second;
+			});
+			static const char* const titles[] = {"still lifes", "oscillators", "spaceships", "other"};
+			static const char* const prefixes[] = {"xs", "xp", "xq", ""};
+			for (size_t k = 0; k < 4; ++k) {
+				uint64_t total = 0U;
+				for (const auto& [code, count]: sorted) {
+					bool match = k < 3 ? code.compare(0, 2, prefixes[k]) == 0
+						: code.compare(0, 2, "xs") && code.compare(0, 2, "xp") && code.compare(0, 2, "xq");
+					if (match) { total += count; }
+				}
+				if (total == 0U) { continue; }
+				fprintf(out, "%s: %llu\n", titles[k], (unsigned long long)total);
+				for (const auto& [code, count]: sorted) {
+					bool match = k < 3 ? code.compare(0, 2, prefixes[k]) == 0
+						: code.compare(0, 2, "xs") && code.compare(0, 2, "xp") && code.compare(0, 2, "xq");
+					if (match) {
+						fprintf(out, "  %-24s %llu\n", code.c_str(), (unsigned long long)count);
+					}
+				}
+			}
+			double rate = seconds > 0.0 ? (double)soups / seconds : 0.0;
+			fprintf(out, "soups:             %llu (%llu unstable)\n",
+				(unsigned long long)soups, (unsigned long long)unstable);
+			fprintf(out, "generations:       %llu\n", (unsigned long long)generations);
+			fprintf(out, "soups/s:           %.1f\n", rate);
+			fprintf(out, "soups/s per core:  %.1f (%zu threads)\n", rate / (double)threads, threads);
+		}
+	};
+
+	// Runs random soups on one engine to stabilization and names the
+	// debris apgsearch style: xs<pop> still lifes, xp<period> oscillators,
+	// xq<period> spaceships, each followed by the canonical Wechsler code.
+	// Spaceships are caught and removed in a border band so they do not
+	// wrap around the torus; the rest is split into objects once the
+	// board is periodic (cells closer than 3 in any phase are grouped,
+	// so every group runs on its own, then the parts of a group that
+	// evolve the same apart are counted apart). Objects are identified
+	// on a small board of the same engine type and rule.
+	template<typename Engine>
+	class SoupSearch {
+	private:
+		rules::Rule rule;
+		CensusOptions options;
+		Engine board;
+		CycleDetector detector;
+		std::vector<uint32_t> label;
+		uint32_t stamp = 0U;
+		std::vector<census::Cell> stack;
+		/* shapes seen before, keyed by their uncanonical encoding */
+		std::unordered_map<std::string, std::pair<std::string, bool>> known;
+		std::unordered_set<std::string> transient;
+
+		////////////////////////////////////////////////////////////
+		size_t side() const noexcept {
+			return options.board;
+		}
+
+		////////////////////////////////////////////////////////////
+		bool live(size_t x, size_t y) {
+			if constexpr (requires { board.Stride(); board.row(0); }) {
+				/* bit boards: no modulo, no staging */
+				return (board.row(y)[x / 64U] >> (x % 64U)) & 1U;
+			} else {
+				return !IsDead(board.get(x, y));
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// first label of a new labelling pass, older labels count as unset
+		uint32_t begin_pass() {
+			if (stamp > UINT32_MAX - (uint32_t)label.size()) {
+				std::fill(label.begin(), label.end(), 0U);
+				stamp = 0U;
+			}
+			return stamp + 1U;
+		}
+
+		////////////////////////////////////////////////////////////
+		// cells of `on` reachable from (x, y) within distance 2, torus
+		// wrapped but returned unwrapped so they form one piece
+		template<typename On>
+		census::Shape flood(size_t x, size_t y, uint32_t pass, On&& on, size_t limit) {
+			const int n = (int)side();
+			const uint32_t id = ++stamp;
+			census::Shape shape;
+			stack.clear();
+			stack.push_back((census::Cell){(int)x, (int)y});
+			label[y*side() + x] = id;
+			while (!stack.empty()) {
+				census::Cell c = stack.back();
+				stack.pop_back();
+				shape.push_back(c);
+				if (shape.size() > limit) { return shape; }
+				for (int dy = -2; dy <= 2; ++dy) {
+					for (int dx = -2; dx <= 2; ++dx) {
+						int ux = c.x + dx, uy = c.y + dy;
+						size_t wx = (size_t)(((ux % n) + n) % n), wy = (size_t)(((uy % n) + n) % n);
+						uint32_t& l = label[wy*side() + wx];
+						if (l >= pass || !on(wx, wy)) { continue; }
+						l = id;
+						stack.push_back((census::Cell){ux, uy});
+					}
+				}
+			}
+			return shape;
+		}
+
+		////////////////////////////////////////////////////////////
+		// evolves a shape alone; the code is empty if it does not come
+		// back (translated or not) within max_period generations
+		std::string classify(census::Shape shape, size_t max_period, int margin, bool* moving = nullptr) {
+			census::Normalize(shape);
+			int w = 0, h = 0;
+			for (const census::Cell& c: shape) {
+				w = std::max(w, c.x + 1);
+				h = std::max(h, c.y + 1);
+			}
+			const size_t lw = (size_t)(w + 2*margin), lh = (size_t)(h + 2*margin);
+			Engine local(lw, lh);
+			ApplyRule(local, rule);
+			local.clear(Dead);
+			for (const census::Cell& c: shape) {
+				local.set((size_t)(c.x + margin), (size_t)(c.y + margin), Alive);
+			}
+			local.apply();
+			std::vector<census::Shape> phases(1, shape);
+			census::Shape current;
+			for (size_t k = 1; k <= max_period; ++k) {
+				Step(local);
+				census::Capture(local, current);
+				/* died out, or growing into something that is not an object */
+				if (current.empty() || current.size() > 4U*shape.size() + 16U) { return std::string(); }
+				census::Cell at = census::Normalize(current);
+				if (current == phases[0]) {
+					bool moved = at.x != margin || at.y != margin;
+					if (moving != nullptr) { *moving = moved; }
+					std::string prefix = moved ? "xq" + std::to_string(k)
+						: k == 1 ? "xs" + std::to_string(shape.size())
+						: "xp" + std::to_string(k);
+					return prefix + "_" + census::Canonical(phases);
+				}
+				phases.push_back(current);
+			}
+			return std::string();
+		}
+
+		////////////////////////////////////////////////////////////
+		// phases 1..steps of the cells on a w x h board, in board
+		// coordinates so runs of different parts line up
+		std::vector<census::Shape> evolve(const census::Shape& cells, size_t w, size_t h, size_t steps) {
+			Engine local(w, h);
+			ApplyRule(local, rule);
+			local.clear(Dead);
+			for (const census::Cell& c: cells) {
+				local.set((size_t)c.x, (size_t)c.y, Alive);
+			}
+			local.apply();
+			std::vector<census::Shape> phases(steps);
+			for (census::Shape& phase: phases) {
+				Step(local);
+				census::Capture(local, phase);
+				std::sort(phase.begin(), phase.end());
+			}
+			return phases;
+		}
+
+		////////////////////////////////////////////////////////////
+		// parts of a group that evolve the same alone as together, so
+		// pseudo still lifes and close constellations are counted apart;
+		// a part that fails takes in its nearest neighbour and tries again
+		std::vector<census::Shape> split(census::Shape shape, size_t period, int margin) {
+			std::vector<census::Shape> pieces = census::Pieces(shape);
+			std::vector<census::Shape> out;
+			if (pieces.size() < 2U) {
+				out.push_back(std::move(shape));
+				return out;
+			}
+			/* one board for every run, big enough for the whole group */
+			const census::Cell low = census::Normalize(shape);
+			int w = 0, h = 0;
+			for (const census::Cell& c: shape) {
+				w = std::max(w, c.x + 1);
+				h = std::max(h, c.y + 1);
+			}
+			const size_t lw = (size_t)(w + 2*margin), lh = (size_t)(h + 2*margin);
+			for (census::Shape& piece: pieces) {
+				for (census::Cell& c: piece) {
+					c.x += margin - low.x;
+					c.y += margin - low.y;
+				}
+			}
+			auto cells_of = [&](const std::vector<size_t>& parts) {
+				census::Shape cells;
+				for (size_t i: parts) {
+					cells.insert(cells.end(), pieces[i].begin(), pieces[i].end());
+				}
+				return cells;
+			};
+			std::vector<size_t> rest(pieces.size());
+			for (size_t i = 0; i < rest.size(); ++i) { rest[i] = i; }
+			std::vector<census::Shape> together = evolve(cells_of(rest), lw, lh, period);
+			census::Shape merged;
+			while (rest.size() > 1U) {
+				std::vector<size_t> group(1U, rest[0]), others(rest.begin() + 1, rest.end());
+				for (;;) {
+					std::vector<census::Shape> alone = evolve(cells_of(group), lw, lh, period);
+					std::vector<census::Shape> apart = evolve(cells_of(others), lw, lh, period);
+					bool same = true;
+					for (size_t k = 0; same && k < period; ++k) {
+						merged.clear();
+						std::set_union(alone[k].begin(), alone[k].end(), apart[k].begin(), apart[k].end(),
+							std::back_inserter(merged));
+						same = merged == together[k];
+					}
+					if (same) {
+						together = std::move(apart);
+						break;
+					}
+					size_t nearest = 0U;
+					int distance = INT_MAX;
+					const census::Shape cells = cells_of(group);
+					for (size_t i = 0; i < others.size(); ++i) {
+						int d = census::Distance(cells, pieces[others[i]]);
+						if (d < distance) {
+							distance = d;
+							nearest = i;
+						}
+					}
+					group.push_back(others[nearest]);
+					others.erase(others.begin() + (std::ptrdiff_t)nearest);
+					if (others.empty()) { break; }
+				}
+				out.push_back(cells_of(group));
+				rest = std::move(others);
+			}
+			if (!rest.empty()) { out.push_back(cells_of(rest)); }
+			return out;
+		}
+
+		////////////////////////////////////////////////////////////
+		// classify() once per distinct shape; soups keep producing the same
+		// few objects
+		std::string identify(census::Shape shape, size_t max_period, int margin, bool* moving = nullptr) {
+			census::Normalize(shape);
+			std::string key = census::Wechsler(shape);
+			auto it = known.find(key);
+			if (it != known.end()) {
+				if (moving != nullptr) { *moving = it->second.second; }
+				return it->second.first;
+			}
+			/* not periodic within a sweep's budget, may still be later */
+			if (moving != nullptr && transient.count(key) != 0U) { return std::string(); }
+			bool moved = false;
+			std::string code = classify(shape, max_period, margin, &moved);
+			if (moving != nullptr) { *moving = moved; }
+			if (!code.empty()) {
+				known.emplace(std::move(key), std::make_pair(code, moved));
+			} else if (moving != nullptr) {
+				transient.insert(std::move(key));
+			}
+			return code;
+		}
+
+		////////////////////////////////////////////////////////////
+		// removes spaceships found in the border band; true if any
+		bool sweep(CensusReport& report) {
+			const size_t n = side(), band = std::min(options.band, n / 2);
+			const uint32_t pass = begin_pass();
+			bool synced = false;
+			auto on = [&](size_t x, size_t y) { return live(x, y); };
+			for (size_t y = 0; y < n; ++y) {
+				const bool edge_row = y < band || y >= n - band;
+				for (size_t x = 0; x < n; ++x) {
+					if (!edge_row && x == band) { x = n - band; }
+					if (label[y*n + x] >= pass || !live(x, y)) { continue; }
+					census::Shape shape = flood(x, y, pass, on, 64U);
+					/* anything bigger is not a lone spaceship */
+					if (shape.size() > 64U) { continue; }
+					bool moving = false;
+					std::string code = identify(shape, 32U, 35, &moving);
+					if (code.empty() || !moving) { continue; }
+					++report.objects[code];
+					if (!synced) {
+						board.sync();
+						synced = true;
+					}
+					for (const census::Cell& c: shape) {
+						board.set((size_t)(((c.x % (int)n) + (int)n) % (int)n),
+							(size_t)(((c.y % (int)n) + (int)n) % (int)n), Dead);
+					}
+				}
+			}
+			if (synced) { board.apply(); }
+			return synced;
+		}
+
+		////////////////////////////////////////////////////////////
+		// splits a periodic board into objects and counts them
+		void count_objects(size_t period, CensusReport& report) {
+			const size_t n = side();
+			std::vector<byte> seen(n*n, 0);
+			for (size_t k = 0; k < period; ++k) {
+				for (size_t y = 0; y < n; ++y) {
+					for (size_t x = 0; x < n; ++x) {
+						seen[y*n + x] |= live(x, y) ? 1 : 0;
+					}
+				}
+				Step(board);
+			}
+			const uint32_t pass = begin_pass();
+			auto on = [&](size_t x, size_t y) { return seen[y*n + x] != 0; };
+			for (size_t y = 0; y < n; ++y) {
+				for (size_t x = 0; x < n; ++x) {
+					if (label[y*n + x] >= pass || seen[y*n + x] == 0) { continue; }
+					census::Shape cells = flood(x, y, pass, on, n*n);
+					/* the object as it is now, out of every cell it ever covers */
+					census::Shape shape;
+					for (const census::Cell& c: cells) {
+						size_t wx = (size_t)(((c.x % (int)n) + (int)n) % (int)n);
+						size_t wy = (size_t)(((c.y % (int)n) + (int)n) % (int)n);
+						if (live(wx, wy)) { shape.push_back(c); }
+					}
+					if (shape.empty()) { continue; }
+					for (census::Shape& part: split(std::move(shape), period, 3)) {
+						std::string code = identify(std::move(part), period, 3);
+						++report.objects[code.empty() ? "zz_UNKNOWN" : code];
+					}
+				}
+			}
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		SoupSearch(const rules::Rule& _rule, const CensusOptions& _options)
+			: rule(_rule), options(_options), board(_options.board, _options.board),
+			label(_options.board*_options.board, 0U) {
+			ApplyRule(board, rule);
+		}
+
+		////////////////////////////////////////////////////////////
+		// soup number `index` of the seed, counted into report
+		void run(uint64_t index, CensusReport& report) {
+			const size_t n = side(), s = std::min(options.soup, n);
+			std::mt19937_64 rng(hash::Mix(options.seed*0x9E3779B97F4A7C15ULL + index));
+			board.clear(Dead);
+			for (size_t y = 0; y < s; ++y) {
+				uint64_t bits = rng();
+				for (size_t x = 0; x < s; ++x) {
+					if (x == 64) { bits = rng(); }
+					if ((bits >> (x % 64)) & 1U) {
+						board.set((n - s) / 2 + x, (n - s) / 2 + y, Alive);
+					}
+				}
+			}
+			board.apply();
+			detector.reset();
+			++report.soups;
+			for (size_t g = 0; g < options.max_generations; ++g) {
+				if (g > 0 && g % options.sweep == 0 && sweep(report)) {
+					detector.reset();
+				}
+				if (detector.observe(g, BoardHash(board))) {
+					report.generations += g;
+					count_objects(detector.Period(), report);
+					return;
+				}
+				Step(board);
+			}
+			report.generations += options.max_generations;
+			++report.unstable;
+		}
+	};
+
+	////////////////////////////////////////////////////////////
+	// objects are cells and their range-1 neighbours: dying states of
+	// Generations rules and wider ranges would be lost
+	inline bool CensusSupports(const rules::Rule& rule) {
+		return rule.states == 2 && rule.radius == 1;
+	}
+
+	////////////////////////////////////////////////////////////
+	// options.soups soups spread over options.threads threads, each
+	// with its own Engine; the rule must pass CensusSupports()
+	template<typename Engine>
+	CensusReport RunCensus(const rules::Rule& rule, CensusOptions options) {
+		if (options.threads == 0U) {
+			options.threads = std::max<size_t>(1U, std::thread::hardware_concurrency());
+		}
+		CensusReport total;
+		total.threads = options.threads;
+		std::mutex merge;
+		std::atomic<uint64_t> next{0U};
+		auto worker = [&]() {
+			SoupSearch<Engine> search(rule, options);
+			CensusReport report;
+			for (uint64_t i = next++; i < options.soups; i = next++) {
+				search.run(i, report);
+			}
+			std::lock_guard<std::mutex> lock(merge);
+			total.merge(report);
+		};
+		auto begin = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (size_t t = 1; t < options.threads; ++t) {
+			threads.emplace_back(worker);
+		}
+		worker();
+		for (std::thread& t: threads) {
+			t.join();
+		}
+		total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		return total;
+	}
+}
+
+#endif
@@ -0,0 +1,478 @@
+#ifndef CLUSTER_LIFE_SO2U
+#define CLUSTER_LIFE_SO2U
+
+#include "mewall.h"
+#include "Rule.hpp"
+#include "BitBuffer.hpp"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace mew::game {
+	namespace cluster {
+		static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared counters must be lock free");
+
+		////////////////////////////////////////////////////////////
+		// sleeps while word == seen; the futex is not private, so it
+		// also wakes across processes sharing the mapping
+		inline void Sleep(std::atomic<uint32_t>& word, uint32_t seen) {
+			syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAIT, seen, nullptr, nullptr, 0);
+		}
+
+		////////////////////////////////////////////////////////////
+		inline void Wake(std::atomic<uint32_t>& word) {
+			syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+		}
+
+		////////////////////////////////////////////////////////////
+		// waits until the counter reaches target (wrapping compare),
+		// spinning briefly before it sleeps
+		inline uint32_t Await(std::atomic<uint32_t>& word, uint32_t target) {
+			for (size_t spin = 0; ; ++spin) {
+				uint32_t v = word.load(std::memory_order_acquire);
+				if ((int32_t)(v - target) >= 0) { return v; }
+				if (spin >= 4096U) { Sleep(word, v); }
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// Await() that sleeps at most 100 ms at a time and gives up,
+		// returning false, when alive() says the other side is gone
+		template<typename Check>
+		inline bool AwaitWhile(std::atomic<uint32_t>& word, uint32_t target, Check&& alive) {
+			const timespec poll = {0, 100L*1000L*1000L};
+			for (size_t spin = 0; ; ++spin) {
+				uint32_t v = word.load(std::memory_order_acquire);
+				if ((int32_t)(v - target) >= 0) { return true; }
+				if (spin < 4096U) { continue; }
+				long r = syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAIT, v, &poll, nullptr, 0);
+				if (r != 0 && errno == ETIMEDOUT && !alive()) { return false; }
+			}
+		}
+	}
+
+	// BitBuffer2d split across worker processes, one horizontal band each.
+	// Every worker keeps its band in private memory and only talks to its
+	// neighbours through a POSIX shared memory segment: after each
+	// generation it publishes its first and last rows into a halo slot
+	// and bumps its sequence counter, then waits for the counters of the
+	// bands above and below and copies their rows in as its own halo.
+	// Slots alternate by generation parity; a neighbour can run at most
+	// one generation ahead (it needs our rows to go on), so two slots are
+	// never overwritten while still being read. No locks, no barriers.
+	//
+	// The calling process is the coordinator: it hands out commands
+	// through a shared counter. The bands stay with the workers across
+	// steps; only when the board is read (get, row, sync, a snapshot)
+	// do they write them into a shared plane that the coordinator copies
+	// into its own board, so renderers read it like any other engine.
+	// Edits are sent back to the workers on the next step().
+	// The coordinator never waits blind: while it waits for the bands it
+	// checks the workers every 100 ms, and if one has died it kills the
+	// rest and steps the last board it holds up to the current
+	// generation on its own; Workers() is 0 from then on.
+	// Nothing but the segment is shared, which is how the split would
+	// stretch over several nodes. Linux only (fork, futex).
+	template<typename Rule = rules::Life>
+	class BasicClusterLife {
+	public:
+		typedef bits::word_t word_t;
+
+	private:
+		enum : uint32_t { op_step = 1U, op_load = 2U, op_stop = 4U, op_gather = 8U };
+
+		struct alignas(64) Control {
+			std::atomic<uint32_t> command;
+			uint32_t op;
+			uint64_t count;
+		};
+
+		struct alignas(64) Peer {
+			std::atomic<uint32_t> published;   /* generations whose edge rows are out */
+			std::atomic<uint32_t> done;        /* last command finished */
+		};
+
+		struct Band {
+			size_t y0 = 0U, y1 = 0U;
+			std::vector<word_t> cur, next;     /* band rows plus a halo row on each side */
+		};
+
+		/* reads gather the workers' bands, so they change these */
+		mutable BasicBitBuffer2d<Rule> board;
+		mutable uint32_t command_seq = 0U;
+		mutable bool stale = false;          /* the workers are ahead of board */
+		mutable bool lost = false;           /* a worker died, board went on alone */
+		mutable uint64_t board_generation = 0U;
+		bits::RowKernel<Rule> kernel;
+		size_t worker_count = 0U;
+		std::vector<pid_t> pids;
+		byte* base = nullptr;
+		size_t mapped = 0U;
+		uint64_t generation = 0U;
+		bool dirty = true;                   /* board is ahead of the workers */
+
+		////////////////////////////////////////////////////////////
+		Control& control() const noexcept {
+			return *(Control*)base;
+		}
+
+		////////////////////////////////////////////////////////////
+		Peer& peer(size_t idx) const noexcept {
+			return ((Peer*)(base + sizeof(Control)))[idx];
+		}
+
+		////////////////////////////////////////////////////////////
+		// edge 0 is the first row of the band, edge 1 the last
+		word_t* halo(size_t idx, uint32_t gen, size_t edge) const noexcept {
+			word_t* p = (word_t*)(base + sizeof(Control) + worker_count*sizeof(Peer));
+			return p + ((idx*2U + (gen & 1U))*2U + edge)*board.Stride();
+		}
+
+		////////////////////////////////////////////////////////////
+		// whole board, exchanged on load and gather
+		word_t* plane() const noexcept {
+			return halo(worker_count, 0U, 0U);
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t segment_bytes(size_t workers) const noexcept {
+			return sizeof(Control) + workers*sizeof(Peer) +
+				(workers*4U + board.Height())*board.Stride()*sizeof(word_t);
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t band_begin(size_t idx) const noexcept {
+			return board.Height()*idx / worker_count;
+		}
+
+		////////////////////////////////////////////////////////////
+		bool map_segment() {
+			char name[64];
+			static std::atomic<uint32_t> serial{0U};
+			snprintf(name, sizeof(name), "/mew-life-%d-%u", (int)getpid(), serial++);
+			int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+			if (fd < 0) { return false; }
+			/* the workers inherit the mapping, the name is not needed past this */
+			shm_unlink(name);
+			mapped = segment_bytes(worker_count);
+			void* ptr = MAP_FAILED;
+			if (ftruncate(fd, (off_t)mapped) == 0) {
+				ptr = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			}
+			::close(fd);
+			if (ptr == MAP_FAILED) {
+				mapped = 0U;
+				return false;
+			}
+			/* a fresh segment is zeroed: all counters start at 0 */
+			base = (byte*)ptr;
+			return true;
+		}
+
+		////////////////////////////////////////////////////////////
+		// worker side: runs in the child until op_stop
+		[[noreturn]] void work(size_t idx, Band& band, pid_t parent) {
+			/* never outlive the coordinator */
+			prctl(PR_SET_PDEATHSIG, SIGKILL);
+			if (getppid() != parent) { _exit(0); }
+			const size_t stride = board.Stride();
+			const size_t rows = band.y1 - band.y0;
+			const size_t up = (idx + worker_count - 1) % worker_count;
+			const size_t dn = (idx + 1) % worker_count;
+			Peer& self = peer(idx);
+			uint32_t seen = 0U, gen = 0U;
+			for (;;) {
+				seen = cluster::Await(control().command, seen + 1U);
+				const uint32_t op = control().op;
+				const uint64_t count = control().count;
+				if (op & op_stop) { _exit(0); }
+				if (op & op_load) {
+					std::copy_n(plane() + band.y0*stride, rows*stride, band.cur.data() + stride);
+				}
+				for (uint64_t g = 0; g < count; ++g, ++gen) {
+					std::copy_n(band.cur.data() + stride, stride, halo(idx, gen, 0));
+					std::copy_n(band.cur.data() + rows*stride, stride, halo(idx, gen, 1));
+					self.published.store(gen + 1U, std::memory_order_release);
+					cluster::Wake(self.published);
+					cluster::Await(peer(up).published, gen + 1U);
+					std::copy_n(halo(up, gen, 1), stride, band.cur.data());
+					cluster::Await(peer(dn).published, gen + 1U);
+					std::copy_n(halo(dn, gen, 0), stride, band.cur.data() + (rows + 1U)*stride);
+					for (size_t r = 1; r <= rows; ++r) {
+						kernel(band.cur.data() + (r-1)*stride, band.cur.data() + r*stride,
+							band.cur.data() + (r+1)*stride, band.next.data() + r*stride);
+					}
+					band.cur.swap(band.next);
+				}
+				if (op & op_gather) {
+					std::copy_n(band.cur.data() + stride, rows*stride, plane() + band.y0*stride);
+				}
+				self.done.store(seen, std::memory_order_release);
+				cluster::Wake(self.done);
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// true while no worker has exited; exited ones are left for
+		// stop_workers() to reap, so their pids are not reused meanwhile
+		bool workers_alive() const {
+			for (pid_t pid: pids) {
+				siginfo_t info;
+				info.si_pid = 0;
+				if (waitid(P_PID, (id_t)pid, &info, WEXITED | WNOHANG | WNOWAIT) != 0 || info.si_pid != 0) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		////////////////////////////////////////////////////////////
+		// coordinator side: posts a command and waits for every band;
+		// false when a worker died and the board went on without them
+		bool command(uint32_t op, uint64_t count) const {
+			control().op = op;
+			control().count = count;
+			control().command.store(++command_seq, std::memory_order_release);
+			cluster::Wake(control().command);
+			if (op & op_stop) { return true; }
+			for (size_t i = 0; i < worker_count; ++i) {
+				if (!cluster::AwaitWhile(peer(i).done, command_seq, [&] { return workers_alive(); })) {
+					abandon();
+					return false;
+				}
+			}
+			return true;
+		}
+
+		////////////////////////////////////////////////////////////
+		// a worker died: the others may wait on it forever, so they go
+		// too, and board catches up from the last generation it holds
+		void abandon() const {
+			for (pid_t pid: pids) {
+				kill(pid, SIGKILL);
+			}
+			lost = true;
+			stale = false;
+			for (; board_generation < generation; ++board_generation) {
+				board.step();
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		void start_workers(size_t count) {
+			worker_count = std::min(count, board.Height());
+			if (!map_segment()) {
+				/* no segment, the coordinator steps the board itself */
+				worker_count = 0U;
+				return;
+			}
+			const pid_t parent = getpid();
+			for (size_t i = 0; i < worker_count; ++i) {
+				/* allocated before fork, the worker never touches the heap */
+				Band band;
+				band.y0 = band_begin(i);
+				band.y1 = band_begin(i + 1);
+				band.cur.assign((band.y1 - band.y0 + 2U)*board.Stride(), 0U);
+				band.next = band.cur;
+				pid_t pid = fork();
+				if (pid == 0) { work(i, band, parent); }
+				if (pid < 0) {
+					stop_workers();
+					return;
+				}
+				pids.push_back(pid);
+			}
+			dirty = true;
+		}
+
+		////////////////////////////////////////////////////////////
+		void stop_workers() {
+			if (base != nullptr && !pids.empty() && !lost) {
+				command(op_stop, 0U);
+			}
+			for (pid_t pid: pids) {
+				waitpid(pid, nullptr, 0);
+			}
+			pids.clear();
+			if (base != nullptr) {
+				munmap(base, mapped);
+				base = nullptr;
+				mapped = 0U;
+			}
+			worker_count = 0U;
+			command_seq = 0U;
+			stale = false;
+			lost = false;
+		}
+
+		////////////////////////////////////////////////////////////
+		// pulls the bands into board once the workers are ahead of it
+		void gather() const {
+			if (!stale) { return; }
+			stale = false;
+			if (!command(op_gather, 0U)) { return; }
+			board_generation = generation;
+			const size_t stride = board.Stride();
+			for (size_t y = 0; y < board.Height(); ++y) {
+				std::copy_n(plane() + y*stride, stride, board.row(y));
+			}
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		BasicClusterLife() {}
+
+		////////////////////////////////////////////////////////////
+		BasicClusterLife(size_t _w, size_t _h, size_t _workers = 0U): board(_w, _h), kernel(_w) {
+			setWorkers(_workers);
+		}
+
+		////////////////////////////////////////////////////////////
+		~BasicClusterLife() {
+			stop_workers();
+		}
+
+		BasicClusterLife(const BasicClusterLife&) = delete;
+		BasicClusterLife& operator=(const BasicClusterLife&) = delete;
+
+		////////////////////////////////////////////////////////////
+		// restarts the workers, 0 picks one process per hardware core;
+		// call before any other thread is started, workers are forked
+		void setWorkers(size_t count) {
+			gather();
+			stop_workers();
+			if (count == 0) {
+				count = std::max<size_t>(1U, std::thread::hardware_concurrency());
+			}
+			start_workers(count);
+		}
+
+		////////////////////////////////////////////////////////////
+		// worker processes, 0 when they could not be started or one died
+		size_t Workers() const noexcept {
+			return lost ? 0U : worker_count;
+		}
+
+		////////////////////////////////////////////////////////////
+		void clear(byte val) {
+			board.clear(val);
+			board_generation = generation;
+			stale = false;
+			dirty = true;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return board.Width();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return board.Height();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Stride() const noexcept {
+			return board.Stride();
+		}
+
+		////////////////////////////////////////////////////////////
+		const word_t* row(size_t y) const {
+			gather();
+			return board.row(y);
+		}
+
+		////////////////////////////////////////////////////////////
+		void set(size_t x, size_t y, byte val) {
+			board.set(x, y, val);
+		}
+
+		////////////////////////////////////////////////////////////
+		byte get(size_t x, size_t y) const {
+			gather();
+			return board.get(x, y);
+		}
+
+		////////////////////////////////////////////////////////////
+		void sync() {
+			gather();
+			board.sync();
+		}
+
+		////////////////////////////////////////////////////////////
+		void apply() {
+			board.apply();
+			board_generation = generation;
+			stale = false;
+			dirty = true;
+		}
+
+		////////////////////////////////////////////////////////////
+		const BasicBitBuffer2d<Rule>& Board() const {
+			gather();
+			return board;
+		}
+
+		////////////////////////////////////////////////////////////
+		// advances `count` generations across the workers; edits since
+		// the last step are loaded first, the result stays with them
+		// until the board is read
+		void step(size_t count = 1U) {
+			if (lost) { stop_workers(); }
+			generation += count;
+			if (worker_count == 0U) {
+				for (size_t g = 0; g < count; ++g) {
+					board.step();
+				}
+				board_generation = generation;
+				return;
+			}
+			const size_t stride = board.Stride();
+			uint32_t op = op_step;
+			if (dirty) {
+				for (size_t y = 0; y < board.Height(); ++y) {
+					std::copy_n(board.row(y), stride, plane() + y*stride);
+				}
+				op |= op_load;
+				dirty = false;
+			}
+			stale = command(op, count);
+		}
+
+		////////////////////////////////////////////////////////////
+		uint64_t Generation() const noexcept {
+			return generation;
+		}
+
+		////////////////////////////////////////////////////////////
+		void setGeneration(uint64_t _generation) {
+			gather();
+			generation = board_generation = _generation;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t population() const {
+			gather();
+			return board.population();
+		}
+	};
+
+	typedef BasicClusterLife<rules::Life> ClusterLife;
+}
+
+#endif
@@ -1,25 +1,51 @@
 #ifndef CONSOLE_RENDER_SO2U
 #define CONSOLE_RENDER_SO2U
 
+#include <array>
 #include <iostream>
+#include <sstream>
 #include "mewall.h"
-#include "DoubleBuffer.hpp"
+#include "Engines.hpp"
+#include "AnsiTerminal.hpp"
+#if defined(__linux__)
+#include "ClusterLife.hpp"
+#endif
 
 namespace mew::game {
 	void DefaultPrinter(std::ostream& os, byte current) {
 		os << current;
 	}
 
-	class ConsoleRenderer {
+	template<typename Buffer>
+	class BasicConsoleRenderer {
 	public:
 		typedef void(*printer_t)(std::ostream&, byte);
-		DoubleBuffer2d<byte> buffer;
+		typedef Buffer buffer_type;
+		Buffer buffer;
 
 		printer_t printer = DefaultPrinter;
 
-		ConsoleRenderer() {}
-		ConsoleRenderer(size_t w, size_t h): buffer(w, h) {}
-		ConsoleRenderer(size_t w, size_t h, printer_t _printer): buffer(w, h), printer(_printer) {}
+	private:
+		std::array<char, 256> glyphs = {};
+		printer_t glyph_printer = nullptr;
+
+		// first character the printer emits for every cell value,
+		// so Present() never goes through the stream per cell
+		void build_glyphs() {
+			std::ostringstream os;
+			for (size_t v = 0; v < glyphs.size(); ++v) {
+				os.str("");
+				printer(os, (byte)v);
+				const std::string& s = os.str();
+				glyphs[v] = s.empty() ? ' ' : s[0];
+			}
+			glyph_printer = printer;
+		}
+
+	public:
+		BasicConsoleRenderer() {}
+		BasicConsoleRenderer(size_t w, size_t h): buffer(w, h) {}
+		BasicConsoleRenderer(size_t w, size_t h, printer_t _printer): buffer(w, h), printer(_printer) {}
 
 		void Render(std::ostream &out, const char splitter = '\n') {
 			for (int y = 0; y < buffer.Height(); ++y) { 
@@ -30,6 +56,20 @@ namespace mew::game {
 			}
 		}
 
+		// diffed frame: only cells that changed since the last Present()
+		// on this terminal are sent; returns the bytes written
+		size_t Present(AnsiTerminal& terminal, std::ostream& out) {
+			if (terminal.Width() != Width() || terminal.Height() != Height()) {
+				terminal.resize(Width(), Height());
+			}
+			if (glyph_printer != printer) {
+				build_glyphs();
+			}
+			return terminal.present(out, [&](size_t x, size_t y) {
+				return glyphs[buffer.get(x, y)];
+			});
+		}
+
 		size_t Width() const noexcept {
 			return buffer.Width();
 		}
@@ -38,6 +78,15 @@ namespace mew::game {
 			return buffer.Height();
 		}
 	};
+
+	typedef BasicConsoleRenderer<DoubleBuffer2d<byte>> ConsoleRenderer;
+	typedef BasicConsoleRenderer<BitBuffer2d> BitConsoleRenderer;
+	typedef BasicConsoleRenderer<HashLife> HashConsoleRenderer;
+	typedef BasicConsoleRenderer<TileLife> TileConsoleRenderer;
+	typedef BasicConsoleRenderer<ParallelLife> ParallelConsoleRenderer;
+#if defined(__linux__)
+	typedef BasicConsoleRenderer<ClusterLife> ClusterConsoleRenderer;
+#endif
 }
 
 
@@ -0,0 +1,362 @@
+#ifndef CYCLE_SO2U
+#define CYCLE_SO2U
+
+#include "mewall.h"
+#include "Hash.hpp"
+#include "Engines.hpp"
+#include <stdint.h>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mew::game {
+	////////////////////////////////////////////////////////////
+	// hash of the current generation; engines that keep one (TileLife)
+	// answer directly, bit boards hash their words one row at a time
+	template<typename Engine>
+	uint64_t BoardHash(Engine& engine) {
+		if constexpr (requires { engine.Hash(); }) {
+			return engine.Hash();
+		} else if constexpr (requires { engine.Board(); }) {
+			return BoardHash(engine.Board());
+		} else if constexpr (requires { engine.Stride(); engine.row(0); }) {
+			uint64_t h = 0U;
+			for (size_t y = 0; y < engine.Height(); ++y) {
+				uint64_t row_hash = 0xCBF29CE484222325ULL;
+				const auto* row = engine.row(y);
+				for (size_t i = 0; i < engine.Stride(); ++i) {
+					row_hash = hash::Combine(row_hash, (uint64_t)row[i]);
+				}
+				h += hash::Tile(y, row_hash);
+			}
+			return h;
+		} else {
+			uint64_t h = 0U;
+			for (size_t y = 0; y < engine.Height(); ++y) {
+				uint64_t row_hash = 0xCBF29CE484222325ULL;
+				for (size_t x = 0; x < engine.Width(); ++x) {
+					row_hash = hash::Combine(row_hash, engine.get(x, y));
+				}
+				h += hash::Tile(y, row_hash);
+			}
+			return h;
+		}
+	}
+
+	// Finds the period of a board from its generation hashes.
+	// The last `capacity` hashes sit in a ring; a repeat at distance P is
+	// only accepted after P more generations each match the one P before
+	// them, which also rules out a stray 64-bit collision.
+	class CycleDetector {
+	private:
+		std::vector<uint64_t> ring;
+		uint64_t tick = 0U;       /* observations since reset() */
+		size_t candidate = 0U;
+		size_t confirmed = 0U;
+		size_t period = 0U;
+		uint64_t stable_since = 0U;
+
+		////////////////////////////////////////////////////////////
+		uint64_t at(uint64_t t) const noexcept {
+			return ring[t % ring.size()];
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		CycleDetector(size_t _capacity = 128U): ring(_capacity < 2U ? 2U : _capacity, 0U) {}
+
+		////////////////////////////////////////////////////////////
+		void reset() noexcept {
+			tick = 0U;
+			candidate = confirmed = period = 0U;
+			stable_since = 0U;
+		}
+
+		////////////////////////////////////////////////////////////
+		// records the hash of `generation`, which must follow the one
+		// observed before; true while a period is established
+		bool observe(uint64_t generation, uint64_t h) {
+			const uint64_t t = tick++;
+			ring[t % ring.size()] = h;
+			const uint64_t filled = tick < ring.size() ? tick : ring.size();
+			if (period != 0U) {
+				if (at(t - period) == h) { return true; }
+				/* the board left its cycle (edited behind our back) */
+				reset();
+				ring[0] = h;
+				tick = 1U;
+				return false;
+			}
+			if (candidate != 0U) {
+				if (at(t - candidate) == h) {
+					if (++confirmed < candidate) { return false; }
+					period = candidate;
+					/* earliest s still in the ring with state(s) == state(s + P) */
+					const uint64_t oldest = tick - filled;
+					uint64_t s = t - period;
+					while (s > oldest && at(s - 1) == at(s - 1 + period)) { --s; }
+					stable_since = generation - (t - s);
+					return true;
+				}
+				candidate = confirmed = 0U;
+			}
+			/* most recent repeat = smallest period */
+			for (size_t d = 1; d < filled; ++d) {
+				if (at(t - d) == h) {
+					candidate = d;
+					confirmed = 0U;
+					break;
+				}
+			}
+			return false;
+		}
+
+		////////////////////////////////////////////////////////////
+		// 0 while no cycle is established, 1 for a still life
+		size_t Period() const noexcept {
+			return period;
+		}
+
+		////////////////////////////////////////////////////////////
+		// first generation that is part of the cycle
+		uint64_t StableSince() const noexcept {
+			return stable_since;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Capacity() const noexcept {
+			return ring.size();
+		}
+	};
+
+	enum class OnCycle: byte {
+		Continue,     /* keep stepping, only report the period */
+		Stop,         /* stop stepping once a cycle is found */
+		FastForward,  /* step() replays the cached cycle, advance(n) steps n mod P */
+	};
+
+	// Any engine plus cycle detection. Engine may be a reference type to
+	// wrap an existing board. Once the board repeats with period P the
+	// policy decides what step() does; any edit (apply/clear) restarts
+	// detection. FastForward records the P phases of an oscillator once
+	// (if they fit in replay_bytes) and step() then only moves to the
+	// next one, get() reads it; the engine gets the phase back before
+	// it is edited or handed out through Inner().
+	template<typename Engine>
+	class CycleLife {
+	public:
+		static constexpr size_t replay_bytes = 64U << 20;
+
+	private:
+		Engine engine;
+		CycleDetector detector;
+		OnCycle policy = OnCycle::FastForward;
+		uint64_t generation = 0U;
+		bool observed = false;
+		std::vector<byte> phases;  /* P boards, row-major, while replaying */
+		size_t phase = 0U;
+
+		////////////////////////////////////////////////////////////
+		bool replaying() const noexcept {
+			return !phases.empty();
+		}
+
+		////////////////////////////////////////////////////////////
+		// steps the engine once around the cycle, keeping every phase
+		void record(size_t period) {
+			const size_t w = engine.Width(), h = engine.Height();
+			if (w*h == 0U || period > replay_bytes / (w*h)) { return; }
+			phases.resize(period*w*h);
+			for (size_t k = 0; k < period; ++k) {
+				byte* out = phases.data() + k*w*h;
+				for (size_t y = 0; y < h; ++y) {
+					for (size_t x = 0; x < w; ++x) {
+						out[y*w + x] = engine.get(x, y);
+					}
+				}
+				Step(engine);
+			}
+			/* P steps later the engine is back at phase 0 */
+			phase = 0U;
+		}
+
+		////////////////////////////////////////////////////////////
+		// writes the current phase back into the engine, ends the replay
+		void settle() {
+			if (!replaying()) { return; }
+			const size_t w = engine.Width(), h = engine.Height();
+			if (phase != 0U) {
+				const byte* in = phases.data() + phase*w*h;
+				engine.sync();
+				for (size_t y = 0; y < h; ++y) {
+					for (size_t x = 0; x < w; ++x) {
+						engine.set(x, y, in[y*w + x]);
+					}
+				}
+				engine.apply();
+			}
+			phases.clear();
+			phases.shrink_to_fit();
+			phase = 0U;
+		}
+
+		////////////////////////////////////////////////////////////
+		void observe() {
+			detector.observe(generation, BoardHash(engine));
+			observed = true;
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		// forwards to Engine's constructor; never taken for a copy
+		template<typename... Args>
+			requires (!(sizeof...(Args) == 1U && (std::is_same_v<std::remove_cvref_t<Args>, CycleLife> && ...)))
+		CycleLife(Args&&... args): engine(std::forward<Args>(args)...) {}
+
+		////////////////////////////////////////////////////////////
+		void setPolicy(OnCycle _policy) noexcept {
+			policy = _policy;
+		}
+
+		////////////////////////////////////////////////////////////
+		OnCycle getPolicy() const noexcept {
+			return policy;
+		}
+
+		////////////////////////////////////////////////////////////
+		void clear(byte val) {
+			engine.clear(val);
+			restart();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return engine.Width();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return engine.Height();
+		}
+
+		////////////////////////////////////////////////////////////
+		void set(size_t x, size_t y, byte val) {
+			settle();
+			engine.set(x, y, val);
+		}
+
+		////////////////////////////////////////////////////////////
+		byte get(size_t x, size_t y) {
+			if (replaying()) {
+				const size_t w = engine.Width(), h = engine.Height();
+				return phases[phase*w*h + (y % h)*w + (x % w)];
+			}
+			return engine.get(x, y);
+		}
+
+		////////////////////////////////////////////////////////////
+		void sync() {
+			settle();
+			engine.sync();
+		}
+
+		////////////////////////////////////////////////////////////
+		void apply() {
+			settle();
+			engine.apply();
+			restart();
+		}
+
+		////////////////////////////////////////////////////////////
+		// forget the history, e.g. after editing the wrapped engine directly
+		void restart() {
+			phases.clear();
+			phase = 0U;
+			detector.reset();
+			observed = false;
+		}
+
+		////////////////////////////////////////////////////////////
+		void step() {
+			if constexpr (!requires { engine.Hash(); }) {
+				/* engines with a maintained hash only know it after a step */
+				if (!observed) { observe(); }
+			}
+			size_t period = detector.Period();
+			if (period != 0U && policy != OnCycle::Continue) {
+				if (policy == OnCycle::Stop) { return; }
+				if (period == 1U) {
+					/* still life: the next generation is this one */
+					++generation;
+					return;
+				}
+				if (!replaying()) { record(period); }
+				if (replaying()) {
+					phase = (phase + 1U) % period;
+					++generation;
+					return;
+				}
+			}
+			Step(engine);
+			++generation;
+			observe();
+		}
+
+		////////////////////////////////////////////////////////////
+		// n generations; with an established period only n mod P are computed
+		void advance(uint64_t n) {
+			while (n > 0U && detector.Period() == 0U) {
+				step();
+				--n;
+			}
+			if (n == 0U) { return; }
+			if (policy == OnCycle::Stop) { return; }
+			if (policy == OnCycle::Continue) {
+				while (n-- > 0U) { step(); }
+				return;
+			}
+			uint64_t period = detector.Period();
+			uint64_t skip = n - n % period;
+			generation += skip;
+			/* state(g + k*P) == state(g): the ring stays valid across the jump */
+			for (uint64_t r = n % period; r > 0U; --r) {
+				step();
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		bool Stopped() const noexcept {
+			return policy == OnCycle::Stop && detector.Period() != 0U;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Period() const noexcept {
+			return detector.Period();
+		}
+
+		////////////////////////////////////////////////////////////
+		uint64_t StableSince() const noexcept {
+			return detector.StableSince();
+		}
+
+		////////////////////////////////////////////////////////////
+		uint64_t Generation() const noexcept {
+			return generation;
+		}
+
+		////////////////////////////////////////////////////////////
+		void setGeneration(uint64_t _generation) {
+			generation = _generation;
+			restart();
+		}
+
+		////////////////////////////////////////////////////////////
+		std::remove_reference_t<Engine>& Inner() {
+			settle();
+			return engine;
+		}
+	};
+}
+
+#endif
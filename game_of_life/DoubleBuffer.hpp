@@ -2,109 +2,142 @@
 #define DOUBLE_BUFFER_SO2U
 
 #include "mewall.h"
-#include <string.h>
+#include "Grid2D.hpp"
 
 namespace mew::game {
+	// Two row-major generations on a torus. The front grid is read,
+	// set() stages into the back grid; swap() exchanges them by pointer
+	// after a step that wrote every cell, apply() copies staged edits
+	// over. Both keep a one cell halo mirroring the opposite edges so
+	// calc_near() reads its neighbours without a modulo.
 	template<typename T>
 	class DoubleBuffer2d {
 	private:
-		size_t width, height;
-		T* _main_buffer;
-		T* _sub_buffer;
+		PingPongGrid2D<T> grids;
+
+		////////////////////////////////////////////////////////////
+		Grid2D<T>& main() noexcept {
+			return grids.front();
+		}
+
+		////////////////////////////////////////////////////////////
+		Grid2D<T>& sub() noexcept {
+			return grids.back();
+		}
+
 	public:
 		////////////////////////////////////////////////////////////
 		DoubleBuffer2d() {}
 
 		////////////////////////////////////////////////////////////
-		DoubleBuffer2d(size_t _w, size_t _h)
-			: width(_w), height(_h), 
-			_main_buffer(new T[size()]), _sub_buffer(new T[size()]) {
-			}
+		DoubleBuffer2d(size_t _w, size_t _h): grids(_w, _h, 1U) {}
 
+		////////////////////////////////////////////////////////////
 		void clear(T val) {
-			for (size_t i = 0; i < size(); ++i) {
-				memcpy(_main_buffer+(i*sizeof(T)), &val, sizeof(T));
-				memcpy(_sub_buffer+(i*sizeof(T)), &val, sizeof(T));
-			}
+			grids.fill(val);
 		}
 
 		////////////////////////////////////////////////////////////
 		size_t size() const noexcept {
-			return width*height;
+			return Width()*Height();
 		}
 
 		////////////////////////////////////////////////////////////
 		size_t Width() const noexcept {
-			return width;
+			return grids.Width();
 		}
 
 		////////////////////////////////////////////////////////////
 		size_t Height() const noexcept {
-			return height;
+			return grids.Height();
 		}
 
 		////////////////////////////////////////////////////////////
-		size_t get_idx(size_t x, size_t y) {
-			return (((x%width)*width)+(y%height));
+		// row-major, coordinates wrap around
+		size_t get_idx(size_t x, size_t y) const noexcept {
+			return (y%Height())*Width() + (x%Width());
 		}
 
 		////////////////////////////////////////////////////////////
 		void set(size_t idx, T val) {
-			_sub_buffer[idx] = val;
-			// memcpy(_sub_buffer+(idx*sizeof(T)), &val, sizeof(T));
+			sub().set(idx%Width(), idx/Width(), val);
 		}
 
 		////////////////////////////////////////////////////////////
 		void set(size_t x, size_t y, T val) {
-			set(get_idx(x, y), val);
+			sub().set(x%Width(), y%Height(), val);
 		}
 
 		////////////////////////////////////////////////////////////
 		T get(size_t idx) {
-			if (idx > size()) {
+			if (idx >= size()) {
 				return (T)0;
 			}
-			return *(_main_buffer+(idx*sizeof(T)));
+			return main().get(idx%Width(), idx/Width());
 		}
 
 		////////////////////////////////////////////////////////////
 		T get(size_t x, size_t y) {
-			return get(get_idx(x, y));
+			return main().get(x%Width(), y%Height());
+		}
+
+		////////////////////////////////////////////////////////////
+		// current generation row y, halo readable at [-1] and [Width()]
+		const T* row(size_t y) {
+			return main().row((ptrdiff_t)y);
 		}
 
 		////////////////////////////////////////////////////////////
+		// staged row y
+		T* sub_row(size_t y) {
+			return sub().row((ptrdiff_t)y);
+		}
+
+		////////////////////////////////////////////////////////////
+		// the back grid holds an older generation after swap(),
+		// call before staging a partial edit
 		void sync() {
-			memcpy(_sub_buffer, _main_buffer, size()*sizeof(T));
+			sub().copyFrom(main());
 		}
 
 		////////////////////////////////////////////////////////////
+		// publishes staged edits, the back grid keeps them too
 		void apply() {
-			memcpy(_main_buffer, _sub_buffer, size()*sizeof(T));
+			main().copyFrom(sub());
+			main().wrapHalo();
+		}
+
+		////////////////////////////////////////////////////////////
+		// publishes a back grid that was written completely
+		void swap() noexcept {
+			grids.flip();
+			main().wrapHalo();
 		}
 
 		////////////////////////////////////////////////////////////
 		size_t calc_square(size_t min_x, size_t min_y, size_t max_x, size_t max_y, T val) {
 			size_t counter = 0U;
-			for (int _x = min_x; _x <= max_x; ++_x) {
-				for (int _y = min_y; _y <= max_y; ++_y) {
+			for (int _y = min_y; _y <= (int)max_y; ++_y) {
+				for (int _x = min_x; _x <= (int)max_x; ++_x) {
 					if (_x >= 0 && _y >= 0 && get(_x, _y) == val) { counter++; }
 				}
 			}
 			return counter;
 		}
-		
+
 		////////////////////////////////////////////////////////////
 		size_t calc_near(size_t x, size_t y, T val) {
-			size_t counter = calc_square(x-1, y-1, x+1, y+1, val);
-			if (get(x, y) == val) {
-				--counter;
-			}
-			return counter;
+			const ptrdiff_t cx = (ptrdiff_t)(x%Width());
+			const ptrdiff_t stride = (ptrdiff_t)main().Stride();
+			const T* mid = row(y%Height()) + cx;
+			const T* up = mid - stride;
+			const T* down = mid + stride;
+			return
+				(size_t)(up[-1] == val) + (size_t)(up[0] == val) + (size_t)(up[1] == val) +
+				(size_t)(mid[-1] == val) +                         (size_t)(mid[1] == val) +
+				(size_t)(down[-1] == val) + (size_t)(down[0] == val) + (size_t)(down[1] == val);
 		}
-
-
-
 	};
 }
 
-#endif
\ No newline at end of file
+#endif
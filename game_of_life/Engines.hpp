@@ -0,0 +1,68 @@
+#ifndef ENGINES_SO2U
+#define ENGINES_SO2U
+
+#include "mewall.h"
+#include "Rule.hpp"
+#include "DoubleBuffer.hpp"
+#include "BitBuffer.hpp"
+#include "HashLife.hpp"
+#include "TileLife.hpp"
+#include "ParallelLife.hpp"
+#include "BlockedLife.hpp"
+#include "RuleEngine.hpp"
+
+namespace mew::game {
+	////////////////////////////////////////////////////////////
+	// reference byte-per-cell step used by the classic engine
+	inline void Step(DoubleBuffer2d<byte>& buffer) {
+		/* every cell is written, so the back grid needs no sync() */
+		for (size_t y = 0; y < buffer.Height(); ++y) {
+			for (size_t x = 0; x < buffer.Width(); ++x) {
+				size_t neightbors = buffer.calc_near(x, y, Alive);
+				byte current = buffer.get(x, y);
+				buffer.set(x, y, NextCell(current, neightbors));
+			}
+		}
+		buffer.swap();
+	}
+
+	////////////////////////////////////////////////////////////
+	template<typename Engine>
+	inline void Step(Engine& engine) {
+		engine.step();
+	}
+
+	////////////////////////////////////////////////////////////
+	// only the runtime-rule engine carries a rule instance
+	template<typename Engine>
+	inline void ApplyRule(Engine&, const rules::Rule&) {}
+
+	////////////////////////////////////////////////////////////
+	inline void ApplyRule(RuleEngine<rules::Rule>& engine, const rules::Rule& rule) {
+		engine.setRule(rule);
+	}
+
+	////////////////////////////////////////////////////////////
+	// Calls fn((Engine*)nullptr) with the fastest engine for a parsed
+	// rule: known two-state rules get a specialized bit-packed board,
+	// known multi-state rules a specialized RuleEngine and anything
+	// else the runtime-table RuleEngine.
+	template<typename Fn>
+	inline int DispatchRule(const rules::Rule& rule, Fn&& fn) {
+		if (rules::Matches<rules::Life>(rule)) {
+			return fn((BasicBitBuffer2d<rules::Life>*)nullptr);
+		}
+		if (rules::Matches<rules::HighLife>(rule)) {
+			return fn((BasicBitBuffer2d<rules::HighLife>*)nullptr);
+		}
+		if (rules::Matches<rules::DayAndNight>(rule)) {
+			return fn((BasicBitBuffer2d<rules::DayAndNight>*)nullptr);
+		}
+		if (rules::Matches<rules::BriansBrain>(rule)) {
+			return fn((RuleEngine<rules::BriansBrain>*)nullptr);
+		}
+		return fn((RuleEngine<rules::Rule>*)nullptr);
+	}
+}
+
+#endif
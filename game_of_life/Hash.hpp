@@ -0,0 +1,31 @@
+#ifndef HASH_SO2U
+#define HASH_SO2U
+
+#include "mewall.h"
+#include <stdint.h>
+
+namespace mew::game {
+	namespace hash {
+		////////////////////////////////////////////////////////////
+		// splitmix64 finalizer
+		constexpr uint64_t Mix(uint64_t h) noexcept {
+			h ^= h >> 30; h *= 0xBF58476D1CE4E5B9ULL;
+			h ^= h >> 27; h *= 0x94D049BB133111EBULL;
+			return h ^ (h >> 31);
+		}
+
+		////////////////////////////////////////////////////////////
+		constexpr uint64_t Combine(uint64_t h, uint64_t v) noexcept {
+			return (h ^ v) * 0x100000001B3ULL;
+		}
+
+		////////////////////////////////////////////////////////////
+		// contribution of one tile to a board hash; boards sum these so a
+		// tile update is board += Tile(idx, new) - Tile(idx, old)
+		constexpr uint64_t Tile(size_t idx, uint64_t tile_hash) noexcept {
+			return Mix(tile_hash + Mix((uint64_t)idx + 1U));
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,555 @@
+#ifndef HASH_LIFE_SO2U
+#define HASH_LIFE_SO2U
+
+#include "mewall.h"
+#include "Rule.hpp"
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+
+namespace mew::game {
+	// Memoized quadtree Life (HashLife).
+	// Every distinct square is stored once (canonical node); each node of
+	// level k caches its center advanced by 2^min(k-2, step) generations,
+	// so repeated structure in space and time is computed only once.
+	// The universe is unbounded; Width()/Height() describe the window
+	// [0, w) x [0, h) seen by the get/set view.
+	template<typename Rule = rules::Life>
+	class BasicHashLife {
+	public:
+		/* largest step(), 2^61 generations: the root then stays below
+		   level 64, where int64 cell offsets run out */
+		static constexpr byte max_step = 61;
+
+		struct Node {
+			Node* nw = nullptr;
+			Node* ne = nullptr;
+			Node* sw = nullptr;
+			Node* se = nullptr;
+			Node* result = nullptr;
+			uint64_t population = 0U;
+			byte level = 0;
+		};
+
+	private:
+		struct Key {
+			Node *nw, *ne, *sw, *se;
+			bool operator==(const Key& k) const noexcept {
+				return nw == k.nw && ne == k.ne && sw == k.sw && se == k.se;
+			}
+		};
+
+		struct KeyHash {
+			size_t operator()(const Key& k) const noexcept {
+				uint64_t h = (uint64_t)(uintptr_t)k.nw;
+				h = h * 0x9E3779B97F4A7C15ULL + (uint64_t)(uintptr_t)k.ne;
+				h = h * 0x9E3779B97F4A7C15ULL + (uint64_t)(uintptr_t)k.sw;
+				h = h * 0x9E3779B97F4A7C15ULL + (uint64_t)(uintptr_t)k.se;
+				return (size_t)(h ^ (h >> 29));
+			}
+		};
+
+		struct PendingCell {
+			int64_t x, y;
+			byte val;
+		};
+
+		size_t width = 0U, height = 0U;
+		std::deque<Node> nodes;
+		std::unordered_map<Key, Node*, KeyHash> table;
+		std::vector<Node*> empties;
+		std::vector<PendingCell> pending;
+		Node* dead_leaf = nullptr;
+		Node* alive_leaf = nullptr;
+		Node* root = nullptr;
+		byte step_log = 0;
+		uint64_t generation = 0U;
+		size_t max_nodes = 1U << 21;
+
+		////////////////////////////////////////////////////////////
+		void init() {
+			nodes.clear();
+			table.clear();
+			empties.clear();
+			nodes.emplace_back();
+			dead_leaf = &nodes.back();
+			nodes.emplace_back();
+			alive_leaf = &nodes.back();
+			alive_leaf->population = 1U;
+			empties.push_back(dead_leaf);
+			root = empty(3);
+		}
+
+		////////////////////////////////////////////////////////////
+		Node* join(Node* nw, Node* ne, Node* sw, Node* se) {
+			Key key = {nw, ne, sw, se};
+			auto it = table.find(key);
+			if (it != table.end()) {
+				return it->second;
+			}
+			nodes.emplace_back();
+			Node* n = &nodes.back();
+			n->nw = nw; n->ne = ne; n->sw = sw; n->se = se;
+			n->level = nw->level + 1;
+			n->population = nw->population + ne->population + sw->population + se->population;
+			table.emplace(key, n);
+			return n;
+		}
+
+		////////////////////////////////////////////////////////////
+		Node* empty(byte level) {
+			while (empties.size() <= level) {
+				Node* e = empties.back();
+				empties.push_back(join(e, e, e, e));
+			}
+			return empties[level];
+		}
+
+		////////////////////////////////////////////////////////////
+		Node* centre(Node* n) {
+			return join(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+		}
+
+		////////////////////////////////////////////////////////////
+		// same-level node wrapped by an empty border
+		Node* expand(Node* n) {
+			Node* e = empty(n->level - 1);
+			return join(
+				join(e, e, e, n->nw), join(e, e, n->ne, e),
+				join(e, n->sw, e, e), join(n->se, e, e, e)
+			);
+		}
+
+		////////////////////////////////////////////////////////////
+		// level 2 node (4x4) -> its 2x2 center one generation later
+		Node* leaf_step(Node* n) {
+			byte cells[4][4];
+			Node* quads[2][2] = {{n->nw, n->ne}, {n->sw, n->se}};
+			for (int qy = 0; qy < 2; ++qy) {
+				for (int qx = 0; qx < 2; ++qx) {
+					Node* q = quads[qy][qx];
+					cells[qy*2+0][qx*2+0] = q->nw == alive_leaf;
+					cells[qy*2+0][qx*2+1] = q->ne == alive_leaf;
+					cells[qy*2+1][qx*2+0] = q->sw == alive_leaf;
+					cells[qy*2+1][qx*2+1] = q->se == alive_leaf;
+				}
+			}
+			Node* out[2][2];
+			for (int y = 1; y <= 2; ++y) {
+				for (int x = 1; x <= 2; ++x) {
+					size_t neighbors = 0U;
+					for (int dy = -1; dy <= 1; ++dy) {
+						for (int dx = -1; dx <= 1; ++dx) {
+							if (dx != 0 || dy != 0) { neighbors += cells[y+dy][x+dx]; }
+						}
+					}
+					out[y-1][x-1] = IsAlive(Rule::next(cells[y][x], neighbors)) ? alive_leaf : dead_leaf;
+				}
+			}
+			return join(out[0][0], out[0][1], out[1][0], out[1][1]);
+		}
+
+		////////////////////////////////////////////////////////////
+		// center of n advanced by 2^min(level-2, step_log) generations
+		Node* next(Node* n) {
+			if (n->result != nullptr) {
+				return n->result;
+			}
+			if (n->population == 0U) {
+				return n->result = empty(n->level - 1);
+			}
+			if (n->level == 2) {
+				return n->result = leaf_step(n);
+			}
+			Node* n00 = n->nw;
+			Node* n01 = join(n->nw->ne, n->ne->nw, n->nw->se, n->ne->sw);
+			Node* n02 = n->ne;
+			Node* n10 = join(n->nw->sw, n->nw->se, n->sw->nw, n->sw->ne);
+			Node* n11 = join(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+			Node* n12 = join(n->ne->sw, n->ne->se, n->se->nw, n->se->ne);
+			Node* n20 = n->sw;
+			Node* n21 = join(n->sw->ne, n->se->nw, n->sw->se, n->se->sw);
+			Node* n22 = n->se;
+			Node *c00, *c01, *c02, *c10, *c11, *c12, *c20, *c21, *c22;
+			if (step_log + 2 >= n->level) {
+				/* full speed: two half steps */
+				c00 = next(n00); c01 = next(n01); c02 = next(n02);
+				c10 = next(n10); c11 = next(n11); c12 = next(n12);
+				c20 = next(n20); c21 = next(n21); c22 = next(n22);
+			} else {
+				/* slower than light: only the second half advances */
+				c00 = centre(n00); c01 = centre(n01); c02 = centre(n02);
+				c10 = centre(n10); c11 = centre(n11); c12 = centre(n12);
+				c20 = centre(n20); c21 = centre(n21); c22 = centre(n22);
+			}
+			return n->result = join(
+				next(join(c00, c01, c10, c11)), next(join(c01, c02, c11, c12)),
+				next(join(c10, c11, c20, c21)), next(join(c11, c12, c21, c22))
+			);
+		}
+
+		////////////////////////////////////////////////////////////
+		// int64 cells of a node past level 64 all lie in the four
+		// level-64 nodes meeting at its center; relative to the center
+		// of theirs, a coordinate only flips its sign bit
+		static int64_t far_offset(int64_t v) noexcept {
+			return (int64_t)((uint64_t)v ^ ((uint64_t)1 << 63));
+		}
+
+		////////////////////////////////////////////////////////////
+		// the level-64 node of quadrant (east, south) touching the center
+		static Node* inner(Node* n, bool east, bool south) noexcept {
+			n = south ? (east ? n->se : n->sw) : (east ? n->ne : n->nw);
+			while (n->level > 64) {
+				n = south ? (east ? n->nw : n->ne) : (east ? n->sw : n->se);
+			}
+			return n;
+		}
+
+		////////////////////////////////////////////////////////////
+		// set_cell below a quadrant node past level 64, x, y relative to
+		// the center of its level-64 node touching the center
+		Node* set_inner(Node* n, bool east, bool south, int64_t x, int64_t y, byte val) {
+			if (n->level == 64) { return set_cell(n, x, y, val); }
+			Node* nw = n->nw; Node* ne = n->ne; Node* sw = n->sw; Node* se = n->se;
+			if (south) {
+				if (east) { nw = set_inner(nw, east, south, x, y, val); }
+				else      { ne = set_inner(ne, east, south, x, y, val); }
+			} else {
+				if (east) { sw = set_inner(sw, east, south, x, y, val); }
+				else      { se = set_inner(se, east, south, x, y, val); }
+			}
+			return join(nw, ne, sw, se);
+		}
+
+		////////////////////////////////////////////////////////////
+		// x, y relative to the node center
+		Node* set_cell(Node* n, int64_t x, int64_t y, byte val) {
+			if (n->level > 64) {
+				const bool east = x >= 0, south = y >= 0;
+				Node* nw = n->nw; Node* ne = n->ne; Node* sw = n->sw; Node* se = n->se;
+				Node*& q = south ? (east ? se : sw) : (east ? ne : nw);
+				q = set_inner(q, east, south, far_offset(x), far_offset(y), val);
+				return join(nw, ne, sw, se);
+			}
+			if (n->level == 0) {
+				return IsAlive(val) ? alive_leaf : dead_leaf;
+			}
+			int64_t off = n->level == 1 ? 0 : ((int64_t)1 << (n->level - 2));
+			Node* nw = n->nw; Node* ne = n->ne; Node* sw = n->sw; Node* se = n->se;
+			if (n->level == 1) {
+				/* children are single cells at -1 / 0 */
+				if (y < 0) { if (x < 0) nw = set_cell(nw, 0, 0, val); else ne = set_cell(ne, 0, 0, val); }
+				else       { if (x < 0) sw = set_cell(sw, 0, 0, val); else se = set_cell(se, 0, 0, val); }
+			} else if (y < 0) {
+				if (x < 0) nw = set_cell(nw, x + off, y + off, val);
+				else       ne = set_cell(ne, x - off, y + off, val);
+			} else {
+				if (x < 0) sw = set_cell(sw, x + off, y - off, val);
+				else       se = set_cell(se, x - off, y - off, val);
+			}
+			return join(nw, ne, sw, se);
+		}
+
+		////////////////////////////////////////////////////////////
+		byte get_cell(Node* n, int64_t x, int64_t y) const {
+			if (n->level > 64) {
+				n = inner(n, x >= 0, y >= 0);
+				x = far_offset(x);
+				y = far_offset(y);
+			}
+			while (n->level > 0) {
+				if (n->population == 0U) { return Dead; }
+				if (n->level == 1) {
+					n = y < 0 ? (x < 0 ? n->nw : n->ne) : (x < 0 ? n->sw : n->se);
+					break;
+				}
+				int64_t off = (int64_t)1 << (n->level - 2);
+				if (y < 0) {
+					if (x < 0) { n = n->nw; x += off; } else { n = n->ne; x -= off; }
+					y += off;
+				} else {
+					if (x < 0) { n = n->sw; x += off; } else { n = n->se; x -= off; }
+					y -= off;
+				}
+			}
+			return n == alive_leaf ? Alive : Dead;
+		}
+
+		////////////////////////////////////////////////////////////
+		bool contains(int64_t x, int64_t y) const noexcept {
+			/* from level 64 on every int64 cell is inside */
+			if (root->level >= 64) { return true; }
+			int64_t half = (int64_t)1 << (root->level - 1);
+			return x >= -half && x < half && y >= -half && y < half;
+		}
+
+		////////////////////////////////////////////////////////////
+		// pattern lies inside the central quarter of the root
+		bool is_padded(Node* n) const noexcept {
+			return n->level >= 3 &&
+				n->nw->population == n->nw->se->se->population &&
+				n->ne->population == n->ne->sw->sw->population &&
+				n->sw->population == n->sw->ne->ne->population &&
+				n->se->population == n->se->nw->nw->population;
+		}
+
+		////////////////////////////////////////////////////////////
+		static uint64_t spread(uint64_t v) noexcept {
+			v &= 0xFFFFFFFFULL;
+			v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+			v = (v | (v << 8)) & 0x00FF00FF00FF00FFULL;
+			v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+			v = (v | (v << 2)) & 0x3333333333333333ULL;
+			v = (v | (v << 1)) & 0x5555555555555555ULL;
+			return v;
+		}
+
+		////////////////////////////////////////////////////////////
+		// node of `level` >= 2 from keyed[begin, end), which is sorted
+		// in Z order so every quadrant is a contiguous range
+		Node* build(byte level, const std::vector<std::pair<uint64_t, byte>>& keyed, size_t begin, size_t end,
+			std::vector<Node*>& small) {
+			if (begin == end) { return empty(level); }
+			if (level == 2) {
+				/* 4x4 squares: 16-bit Z-order mask, one join per distinct mask */
+				uint32_t mask = 0U;
+				for (size_t i = begin; i < end; ++i) {
+					uint32_t bit = 1U << (keyed[i].first & 15U);
+					mask = IsAlive(keyed[i].second) ? (mask | bit) : (mask & ~bit);
+				}
+				if (small[mask] == nullptr) {
+					Node* q[4];
+					for (size_t k = 0; k < 4; ++k) {
+						uint32_t m = mask >> (4*k);
+						q[k] = join(
+							(m & 1U) ? alive_leaf : dead_leaf, (m & 2U) ? alive_leaf : dead_leaf,
+							(m & 4U) ? alive_leaf : dead_leaf, (m & 8U) ? alive_leaf : dead_leaf);
+					}
+					small[mask] = join(q[0], q[1], q[2], q[3]);
+				}
+				return small[mask];
+			}
+			const unsigned shift = 2U*(level - 1U);
+			size_t bounds[5] = {begin, 0, 0, 0, end};
+			for (uint64_t q = 1; q < 4; ++q) {
+				bounds[q] = std::partition_point(keyed.begin() + bounds[q-1], keyed.begin() + end,
+					[&](const std::pair<uint64_t, byte>& c) { return ((c.first >> shift) & 3U) < q; }) - keyed.begin();
+			}
+			return join(
+				build(level-1, keyed, bounds[0], bounds[1], small), build(level-1, keyed, bounds[1], bounds[2], small),
+				build(level-1, keyed, bounds[2], bounds[3], small), build(level-1, keyed, bounds[3], bounds[4], small)
+			);
+		}
+
+		////////////////////////////////////////////////////////////
+		Node* rebuild(Node* n, std::unordered_map<Node*, Node*>& moved) {
+			auto it = moved.find(n);
+			if (it != moved.end()) { return it->second; }
+			Node* copy = join(rebuild(n->nw, moved), rebuild(n->ne, moved),
+				rebuild(n->sw, moved), rebuild(n->se, moved));
+			moved.emplace(n, copy);
+			return copy;
+		}
+
+		////////////////////////////////////////////////////////////
+		// drops every node (and cached result) unreachable from the root
+		void collect() {
+			std::deque<Node> old_nodes;
+			old_nodes.swap(nodes);
+			Node* old_dead = dead_leaf;
+			Node* old_alive = alive_leaf;
+			Node* old_root = root;
+			init();
+			std::unordered_map<Node*, Node*> moved;
+			moved.emplace(old_dead, dead_leaf);
+			moved.emplace(old_alive, alive_leaf);
+			root = rebuild(old_root, moved);
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		BasicHashLife() { init(); }
+
+		////////////////////////////////////////////////////////////
+		BasicHashLife(size_t _w, size_t _h): width(_w), height(_h) { init(); }
+
+		////////////////////////////////////////////////////////////
+		void clear(byte val) {
+			MewUserAssert(IsDead(val), "unbounded universe can only be cleared to dead cells");
+			pending.clear();
+			generation = 0U;
+			init();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return width;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return height;
+		}
+
+		////////////////////////////////////////////////////////////
+		void set(size_t x, size_t y, byte val) {
+			setCell((int64_t)x, (int64_t)y, val);
+		}
+
+		////////////////////////////////////////////////////////////
+		// staged until apply(), like DoubleBuffer2d::set
+		void setCell(int64_t x, int64_t y, byte val) {
+			pending.push_back({x, y, val});
+		}
+
+		////////////////////////////////////////////////////////////
+		byte get(size_t x, size_t y) const {
+			return getCell((int64_t)x, (int64_t)y);
+		}
+
+		////////////////////////////////////////////////////////////
+		byte getCell(int64_t x, int64_t y) const {
+			if (!contains(x, y)) { return Dead; }
+			return get_cell(root, x, y);
+		}
+
+		////////////////////////////////////////////////////////////
+		void apply() {
+			if (root->population == 0U && pending.size() > 64U) {
+				/* bulk load into an empty universe: Z-order sort, build bottom-up */
+				for (const PendingCell& c: pending) {
+					while (!contains(c.x, c.y)) {
+						root = expand(root);
+					}
+				}
+				if (root->level <= 32) {
+					const int64_t half = (int64_t)1 << (root->level - 1);
+					std::vector<std::pair<uint64_t, byte>> keyed;
+					keyed.reserve(pending.size());
+					for (const PendingCell& c: pending) {
+						uint64_t key = spread((uint64_t)(c.x + half)) | (spread((uint64_t)(c.y + half)) << 1);
+						keyed.emplace_back(key, c.val);
+					}
+					/* stable: the last write to a cell wins */
+					std::stable_sort(keyed.begin(), keyed.end(),
+						[](const std::pair<uint64_t, byte>& a, const std::pair<uint64_t, byte>& b) { return a.first < b.first; });
+					std::vector<Node*> small(1U << 16, nullptr);
+					root = build(root->level, keyed, 0, keyed.size(), small);
+					pending.clear();
+					return;
+				}
+			}
+			for (const PendingCell& c: pending) {
+				while (!contains(c.x, c.y)) {
+					root = expand(root);
+				}
+				root = set_cell(root, c.x, c.y, c.val);
+			}
+			pending.clear();
+		}
+
+		////////////////////////////////////////////////////////////
+		void sync() {
+			pending.clear();
+		}
+
+		////////////////////////////////////////////////////////////
+		// every step() advances 2^k generations, k at most max_step
+		void setStep(byte k) {
+			/* 2^k has to fit the 64-bit generation counter */
+			k = std::min(k, max_step);
+			if (k == step_log) { return; }
+			step_log = k;
+			for (Node& n: nodes) {
+				n.result = nullptr;
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		byte getStep() const noexcept {
+			return step_log;
+		}
+
+		////////////////////////////////////////////////////////////
+		void setMaxNodes(size_t count) noexcept {
+			max_nodes = count;
+		}
+
+		////////////////////////////////////////////////////////////
+		void step() {
+			while (root->level < step_log + 2 || !is_padded(root)) {
+				root = expand(root);
+			}
+			root = next(expand(root));
+			generation += (uint64_t)1 << step_log;
+			if (nodes.size() > max_nodes) {
+				collect();
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		void jump(byte k) {
+			setStep(k);
+			step();
+		}
+
+		////////////////////////////////////////////////////////////
+		uint64_t Generation() const noexcept {
+			return generation;
+		}
+
+		////////////////////////////////////////////////////////////
+		uint64_t population() const noexcept {
+			return root->population;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t NodeCount() const noexcept {
+			return nodes.size();
+		}
+
+		////////////////////////////////////////////////////////////
+		Node* Root() const noexcept {
+			return root;
+		}
+
+		////////////////////////////////////////////////////////////
+		Node* Leaf(byte val) const noexcept {
+			return IsAlive(val) ? alive_leaf : dead_leaf;
+		}
+
+		////////////////////////////////////////////////////////////
+		Node* MakeNode(Node* nw, Node* ne, Node* sw, Node* se) {
+			return join(nw, ne, sw, se);
+		}
+
+		////////////////////////////////////////////////////////////
+		Node* EmptyNode(byte level) {
+			return empty(level);
+		}
+
+		////////////////////////////////////////////////////////////
+		// replaces the universe with n, its top-left corner at (0, 0)
+		void setRoot(Node* n) {
+			Node* e = empty(n->level);
+			root = join(e, e, e, n);
+			while (root->level < 3) {
+				root = expand(root);
+			}
+			pending.clear();
+		}
+
+		////////////////////////////////////////////////////////////
+		void setGeneration(uint64_t _generation) noexcept {
+			generation = _generation;
+		}
+	};
+
+	typedef BasicHashLife<rules::Life> HashLife;
+}
+
+#endif
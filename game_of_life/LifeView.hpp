@@ -0,0 +1,242 @@
+#ifndef LIFE_VIEW_SO2U
+#define LIFE_VIEW_SO2U
+
+#include "raylib.h"
+#include "mewall.h"
+#include "Simulation.hpp"
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+namespace mew::game {
+	// Pan/zoom view of a Snapshot. Only the cells inside the window are
+	// looked at: they are written one texel per cell into a streaming
+	// texture (a single UpdateTextureRec per frame) that is drawn scaled
+	// with point filtering, instead of one DrawRectangle per cell.
+	// Below one pixel per cell the view switches to a density mipmap:
+	// level L holds the live count of every 2^L x 2^L block and is shaded
+	// by density, so a zoomed-out frame costs one texel per block.
+	class LifeView {
+	public:
+		typedef Color(*color_t)(byte);
+
+	private:
+		color_t color;
+		float zoom = 20.0f;              /* pixels per cell */
+		Vector2 origin = {0.0f, 0.0f};   /* board cell at the window's top-left */
+		Texture2D texture = {0};
+		std::vector<Color> pixels;
+		/* mipmap levels 1.., rebuilt once per new generation */
+		std::vector<std::vector<uint32_t>> levels;
+		const Snapshot* mip_frame = nullptr;
+		uint64_t mip_generation = 0U;
+		size_t mip_built = 0U;
+		size_t level = 0U;
+		size_t drawn = 0U;
+
+		////////////////////////////////////////////////////////////
+		static size_t level_size(size_t n, size_t l) {
+			return (n + ((size_t)1 << l) - 1) >> l;
+		}
+
+		////////////////////////////////////////////////////////////
+		// texture at least w x h texels, kept across frames
+		void reserve(int w, int h) {
+			if (texture.id != 0 && texture.width >= w && texture.height >= h) { return; }
+			if (texture.id != 0) { UnloadTexture(texture); }
+			w = std::max(w, texture.width);
+			h = std::max(h, texture.height);
+			Image image = GenImageColor(w, h, BLANK);
+			texture = LoadTextureFromImage(image);
+			UnloadImage(image);
+			SetTextureFilter(texture, TEXTURE_FILTER_POINT);
+		}
+
+		////////////////////////////////////////////////////////////
+		// live counts of level l from level l-1 (level 0 is the frame)
+		void build_level(const Snapshot& frame, size_t l) {
+			const size_t pw = level_size(frame.width, l-1), ph = level_size(frame.height, l-1);
+			const size_t w = level_size(frame.width, l), h = level_size(frame.height, l);
+			std::vector<uint32_t>& out = levels[l-1];
+			out.assign(w*h, 0U);
+			for (size_t y = 0; y < ph; ++y) {
+				uint32_t* dst = out.data() + (y >> 1)*w;
+				if (l == 1) {
+					const byte* src = frame.cells.data() + y*pw;
+					for (size_t x = 0; x < pw; ++x) {
+						dst[x >> 1] += IsAlive(src[x]) ? 1U : 0U;
+					}
+				} else {
+					const uint32_t* src = levels[l-2].data() + y*pw;
+					for (size_t x = 0; x < pw; ++x) {
+						dst[x >> 1] += src[x];
+					}
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		void build_mipmap(const Snapshot& frame, size_t l) {
+			if (mip_frame != &frame || mip_generation != frame.generation) {
+				mip_frame = &frame;
+				mip_generation = frame.generation;
+				mip_built = 0U;
+			}
+			if (levels.size() < l) { levels.resize(l); }
+			for (; mip_built < l; ++mip_built) {
+				build_level(frame, mip_built + 1U);
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		Color density_color(uint32_t count, size_t area) const {
+			/* sqrt lifts sparse soups out of the background */
+			float d = sqrtf((float)count / (float)area);
+			byte v = (byte)(255.0f - 255.0f*std::min(d, 1.0f));
+			return (Color){v, v, v, 255};
+		}
+
+		////////////////////////////////////////////////////////////
+		void draw_grid(const Rectangle& dest, size_t cols, size_t rows) {
+			for (size_t x = 0; x <= cols; ++x) {
+				int sx = (int)(dest.x + (float)x*zoom);
+				DrawLine(sx, (int)dest.y, sx, (int)(dest.y + dest.height), BLACK);
+			}
+			for (size_t y = 0; y <= rows; ++y) {
+				int sy = (int)(dest.y + (float)y*zoom);
+				DrawLine((int)dest.x, sy, (int)(dest.x + dest.width), sy, BLACK);
+			}
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		LifeView(color_t _color): color(_color) {}
+
+		////////////////////////////////////////////////////////////
+		~LifeView() {
+			if (texture.id != 0) { UnloadTexture(texture); }
+		}
+
+		LifeView(const LifeView&) = delete;
+		LifeView& operator=(const LifeView&) = delete;
+
+		////////////////////////////////////////////////////////////
+		float Zoom() const noexcept {
+			return zoom;
+		}
+
+		////////////////////////////////////////////////////////////
+		// mipmap level of the last draw, 0 at one pixel per cell or more
+		size_t Level() const noexcept {
+			return level;
+		}
+
+		////////////////////////////////////////////////////////////
+		// texels written by the last draw
+		size_t Drawn() const noexcept {
+			return drawn;
+		}
+
+		////////////////////////////////////////////////////////////
+		void setZoom(float _zoom) {
+			zoom = std::clamp(_zoom, 1.0f/4096.0f, 256.0f);
+		}
+
+		////////////////////////////////////////////////////////////
+		// moves the view by a screen-space delta
+		void pan(Vector2 delta) {
+			origin.x -= delta.x / zoom;
+			origin.y -= delta.y / zoom;
+		}
+
+		////////////////////////////////////////////////////////////
+		// zooms keeping the cell under the screen point in place
+		void zoomAt(Vector2 point, float factor) {
+			Vector2 cell = {origin.x + point.x/zoom, origin.y + point.y/zoom};
+			setZoom(zoom*factor);
+			origin = (Vector2){cell.x - point.x/zoom, cell.y - point.y/zoom};
+		}
+
+		////////////////////////////////////////////////////////////
+		// whole board in a w x h window
+		void fit(size_t board_w, size_t board_h, float w, float h) {
+			setZoom(std::min(w / (float)std::max<size_t>(board_w, 1U), h / (float)std::max<size_t>(board_h, 1U)));
+			origin = (Vector2){0.0f, 0.0f};
+		}
+
+		////////////////////////////////////////////////////////////
+		// wheel zooms at the cursor, right/middle drag or arrows pan
+		void handleInput() {
+			float wheel = GetMouseWheelMove();
+			if (wheel != 0.0f) {
+				zoomAt(GetMousePosition(), powf(1.25f, wheel));
+			}
+			if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT) || IsMouseButtonDown(MOUSE_BUTTON_MIDDLE)) {
+				pan(GetMouseDelta());
+			}
+			const float step = 600.0f*GetFrameTime();
+			if (IsKeyDown(KEY_LEFT))  { pan((Vector2){step, 0.0f}); }
+			if (IsKeyDown(KEY_RIGHT)) { pan((Vector2){-step, 0.0f}); }
+			if (IsKeyDown(KEY_UP))    { pan((Vector2){0.0f, step}); }
+			if (IsKeyDown(KEY_DOWN))  { pan((Vector2){0.0f, -step}); }
+		}
+
+		////////////////////////////////////////////////////////////
+		void draw(const Snapshot& frame, Rectangle area) {
+			drawn = 0U;
+			/* texels are cells, or 2^level blocks below one pixel per cell */
+			level = 0U;
+			while (zoom*(float)((size_t)1 << level) < 1.0f) { ++level; }
+			const size_t block = (size_t)1 << level;
+			const float texel = zoom*(float)block;
+			const size_t lw = level_size(frame.width, level), lh = level_size(frame.height, level);
+			/* visible texel range, clipped to the board */
+			const float tx = origin.x / (float)block, ty = origin.y / (float)block;
+			const ptrdiff_t bx0 = std::max<ptrdiff_t>(0, (ptrdiff_t)floorf(tx));
+			const ptrdiff_t by0 = std::max<ptrdiff_t>(0, (ptrdiff_t)floorf(ty));
+			const ptrdiff_t bx1 = std::min<ptrdiff_t>((ptrdiff_t)lw, (ptrdiff_t)ceilf(tx + area.width/texel));
+			const ptrdiff_t by1 = std::min<ptrdiff_t>((ptrdiff_t)lh, (ptrdiff_t)ceilf(ty + area.height/texel));
+			if (bx1 <= bx0 || by1 <= by0) { return; }
+			const size_t cols = (size_t)(bx1 - bx0), rows = (size_t)(by1 - by0);
+			reserve((int)cols, (int)rows);
+			pixels.resize(cols*rows);
+			if (level == 0U) {
+				for (size_t y = 0; y < rows; ++y) {
+					const byte* src = frame.cells.data() + (by0 + y)*frame.width + bx0;
+					Color* dst = pixels.data() + y*cols;
+					for (size_t x = 0; x < cols; ++x) {
+						dst[x] = color(src[x]);
+					}
+				}
+			} else {
+				build_mipmap(frame, level);
+				const std::vector<uint32_t>& counts = levels[level-1];
+				for (size_t y = 0; y < rows; ++y) {
+					const size_t cy = (by0 + y)*block;
+					const size_t area_h = std::min(block, frame.height - cy);
+					const uint32_t* src = counts.data() + (by0 + y)*lw + bx0;
+					Color* dst = pixels.data() + y*cols;
+					for (size_t x = 0; x < cols; ++x) {
+						const size_t cx = (bx0 + x)*block;
+						dst[x] = density_color(src[x], area_h*std::min(block, frame.width - cx));
+					}
+				}
+			}
+			UpdateTextureRec(texture, (Rectangle){0.0f, 0.0f, (float)cols, (float)rows}, pixels.data());
+			drawn = cols*rows;
+			Rectangle source = {0.0f, 0.0f, (float)cols, (float)rows};
+			Rectangle dest = {
+				area.x + ((float)bx0 - tx)*texel, area.y + ((float)by0 - ty)*texel,
+				(float)cols*texel, (float)rows*texel
+			};
+			DrawTexturePro(texture, source, dest, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
+			if (zoom >= 6.0f) {
+				/* only the lines of visible cells */
+				draw_grid(dest, cols, rows);
+			}
+		}
+	};
+}
+
+#endif
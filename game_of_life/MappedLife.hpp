@@ -0,0 +1,382 @@
+#ifndef MAPPED_LIFE_SO2U
+#define MAPPED_LIFE_SO2U
+
+#include "mewall.h"
+#include "Rule.hpp"
+#include "BitBuffer.hpp"
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mew::game {
+	// Bit-packed Life universe that lives in a memory-mapped file instead
+	// of RAM, so the board may be larger than memory (100k x 100k is
+	// 1.2 GB per plane). The file holds a header page and two planes laid
+	// out like BitBuffer2d rows; the header names the front plane and the
+	// generation, so reopening the file resumes where the run stopped.
+	//
+	// step() streams the front plane once, top to bottom, in bands of
+	// rows: each row is computed from the rows above and below it, the
+	// torus rows (first and last) are kept in memory, finished bands are
+	// handed to write-back and dropped from the mapping. What stays
+	// resident is left to the page cache.
+	template<typename Rule = rules::Life>
+	class BasicMappedLife {
+	public:
+		typedef bits::word_t word_t;
+
+	private:
+		static constexpr size_t header_bytes = 4096U;
+		static constexpr char magic[8] = {'M', 'E', 'W', 'L', 'I', 'F', 'E', '1'};
+
+		struct Header {
+			char magic[8];
+			uint64_t width, height, stride;
+			uint64_t generation;
+			uint32_t front;         /* plane holding the current generation */
+			uint32_t birth, survive;
+		};
+
+		int fd = -1;
+		byte* base = nullptr;
+		size_t mapped = 0U;
+		size_t width = 0U, height = 0U, stride = 0U;
+		size_t band_rows = 1U;
+		bits::RowKernel<Rule> kernel;
+		bool resumed = false;
+
+		////////////////////////////////////////////////////////////
+		Header* header() const noexcept {
+			return (Header*)base;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t plane_words() const noexcept {
+			return stride*height;
+		}
+
+		////////////////////////////////////////////////////////////
+		word_t* plane(size_t idx) const noexcept {
+			return (word_t*)(base + header_bytes) + idx*plane_words();
+		}
+
+		////////////////////////////////////////////////////////////
+		word_t* front_plane() const noexcept {
+			return plane(header()->front);
+		}
+
+		////////////////////////////////////////////////////////////
+		word_t* back_plane() const noexcept {
+			return plane(header()->front ^ 1U);
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t file_bytes() const noexcept {
+			return header_bytes + 2U*plane_words()*sizeof(word_t);
+		}
+
+		////////////////////////////////////////////////////////////
+		static size_t page_size() {
+			static const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+			return page;
+		}
+
+		////////////////////////////////////////////////////////////
+		bool map() {
+			mapped = file_bytes();
+			void* ptr = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (ptr == MAP_FAILED) {
+				mapped = 0U;
+				return false;
+			}
+			base = (byte*)ptr;
+			/* one pass per generation, front to back */
+			madvise(base + header_bytes, mapped - header_bytes, MADV_SEQUENTIAL);
+			return true;
+		}
+
+		////////////////////////////////////////////////////////////
+		void unmap() {
+			if (base == nullptr) { return; }
+			munmap(base, mapped);
+			base = nullptr;
+			mapped = 0U;
+		}
+
+		////////////////////////////////////////////////////////////
+		void set_size(size_t _w, size_t _h) {
+			width = _w;
+			height = _h;
+			kernel = bits::RowKernel<Rule>(_w);
+			stride = kernel.Stride();
+			/* about 4 MB of rows per band */
+			band_rows = std::max<size_t>(1U, (4U << 20) / (stride*sizeof(word_t)));
+		}
+
+		////////////////////////////////////////////////////////////
+		bool read_header(Header& h) const {
+			struct stat st;
+			if (fstat(fd, &st) != 0 || (size_t)st.st_size < header_bytes) { return false; }
+			if (pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) { return false; }
+			if (memcmp(h.magic, magic, sizeof(magic)) != 0) { return false; }
+			if (h.width == 0U || h.height == 0U || h.front > 1U) { return false; }
+			if (h.stride != (h.width + bits::word_bits - 1) / bits::word_bits) { return false; }
+			return header_bytes + 2U*h.stride*h.height*sizeof(word_t) <= (size_t)st.st_size;
+		}
+
+		////////////////////////////////////////////////////////////
+		// rows [y0, y1) of the source were consumed and written: start
+		// write-back of the output and drop both from our mapping
+		void release(size_t y0, size_t y1) {
+			const size_t page = page_size();
+			const uintptr_t at = (uintptr_t)back_plane() + y0*stride*sizeof(word_t);
+			const uintptr_t to = (uintptr_t)back_plane() + y1*stride*sizeof(word_t);
+			uintptr_t begin = at / page * page;
+			msync((void*)begin, to - begin, MS_ASYNC);
+			for (word_t* p: {front_plane(), back_plane()}) {
+				/* inward rounding, never drops a page that is still in use */
+				uintptr_t first = ((uintptr_t)p + y0*stride*sizeof(word_t) + page - 1) / page * page;
+				uintptr_t last = ((uintptr_t)p + y1*stride*sizeof(word_t)) / page * page;
+				if (last > first) {
+					madvise((void*)first, last - first, MADV_DONTNEED);
+				}
+			}
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		BasicMappedLife() {}
+
+		////////////////////////////////////////////////////////////
+		BasicMappedLife(const char* path, size_t _w, size_t _h) {
+			open(path, _w, _h);
+		}
+
+		////////////////////////////////////////////////////////////
+		~BasicMappedLife() {
+			close();
+		}
+
+		BasicMappedLife(const BasicMappedLife&) = delete;
+		BasicMappedLife& operator=(const BasicMappedLife&) = delete;
+
+		////////////////////////////////////////////////////////////
+		// resumes the universe stored in path, or creates a dead _w x _h
+		// one if the file is missing or empty; a stored universe keeps
+		// its own size, any other file is left alone and open() fails
+		bool open(const char* path, size_t _w, size_t _h) {
+			close();
+			fd = ::open(path, O_RDWR | O_CREAT, 0644);
+			if (fd < 0) { return false; }
+			Header stored;
+			resumed = read_header(stored);
+			if (resumed && (stored.birth != Rule::birth || stored.survive != Rule::survive)) {
+				/* written by another rule, refuse rather than overwrite it */
+				close();
+				return false;
+			}
+			struct stat st;
+			if (!resumed && (fstat(fd, &st) != 0 || st.st_size != 0)) {
+				/* not a universe (a mistyped --file), refuse rather than overwrite it */
+				close();
+				return false;
+			}
+			if (resumed) {
+				set_size(stored.width, stored.height);
+			} else {
+				MewUserAssert(_w > 0 && _h > 0, "empty board");
+				set_size(_w, _h);
+				/* a fresh file is sparse, both planes read as dead */
+				if (ftruncate(fd, (off_t)file_bytes()) != 0) {
+					close();
+					return false;
+				}
+			}
+			if (!map()) {
+				close();
+				return false;
+			}
+			if (!resumed) {
+				Header* h = header();
+				memcpy(h->magic, magic, sizeof(magic));
+				h->width = width;
+				h->height = height;
+				h->stride = stride;
+				h->generation = 0U;
+				h->front = 0U;
+				h->birth = Rule::birth;
+				h->survive = Rule::survive;
+			}
+			return true;
+		}
+
+		////////////////////////////////////////////////////////////
+		void close() {
+			if (base != nullptr) { flush(); }
+			unmap();
+			if (fd >= 0) {
+				::close(fd);
+				fd = -1;
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// makes the current generation durable: planes first, then the
+		// header that points at them
+		void flush() {
+			if (base == nullptr) { return; }
+			msync(base + header_bytes, mapped - header_bytes, MS_SYNC);
+			msync(base, header_bytes, MS_SYNC);
+		}
+
+		////////////////////////////////////////////////////////////
+		bool Good() const noexcept {
+			return base != nullptr;
+		}
+
+		////////////////////////////////////////////////////////////
+		// true when open() picked up an existing universe
+		bool Resumed() const noexcept {
+			return resumed;
+		}
+
+		////////////////////////////////////////////////////////////
+		// rows streamed between two write-back hints
+		void setBand(size_t rows) {
+			band_rows = rows == 0U ? 1U : rows;
+		}
+
+		////////////////////////////////////////////////////////////
+		void clear(byte val) {
+			if (IsDead(val)) {
+				/* punch both planes back to sparse instead of writing them */
+				Header saved = *header();
+				unmap();
+				if (ftruncate(fd, (off_t)header_bytes) != 0 ||
+					ftruncate(fd, (off_t)file_bytes()) != 0 || !map()) {
+					MewUserAssert(false, "cannot clear the universe file");
+					return;
+				}
+				*header() = saved;
+				return;
+			}
+			for (word_t* p: {plane(0), plane(1)}) {
+				for (size_t y = 0; y < height; ++y) {
+					std::fill_n(p + y*stride, stride, ~(word_t)0);
+					p[y*stride + stride - 1] &= kernel.LastMask();
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t size() const noexcept {
+			return width*height;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return width;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return height;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Stride() const noexcept {
+			return stride;
+		}
+
+		////////////////////////////////////////////////////////////
+		const word_t* row(size_t y) const noexcept {
+			return front_plane() + y*stride;
+		}
+
+		////////////////////////////////////////////////////////////
+		word_t* sub_row(size_t y) noexcept {
+			return back_plane() + y*stride;
+		}
+
+		////////////////////////////////////////////////////////////
+		void set(size_t x, size_t y, byte val) {
+			x %= width; y %= height;
+			word_t& w = sub_row(y)[x/bits::word_bits];
+			word_t bit = (word_t)1 << (x % bits::word_bits);
+			w = val ? (w | bit) : (w & ~bit);
+		}
+
+		////////////////////////////////////////////////////////////
+		byte get(size_t x, size_t y) const {
+			x %= width; y %= height;
+			return (byte)((row(y)[x/bits::word_bits] >> (x % bits::word_bits)) & 1U);
+		}
+
+		////////////////////////////////////////////////////////////
+		// the back plane holds the previous generation after step(),
+		// call before staging edits
+		void sync() {
+			std::copy_n(front_plane(), plane_words(), back_plane());
+		}
+
+		////////////////////////////////////////////////////////////
+		void apply() {
+			std::copy_n(back_plane(), plane_words(), front_plane());
+		}
+
+		////////////////////////////////////////////////////////////
+		void swap() noexcept {
+			header()->front ^= 1U;
+		}
+
+		////////////////////////////////////////////////////////////
+		void step() {
+			/* the torus rows are read again at the far end of the pass */
+			std::vector<word_t> first(row(0), row(0) + stride);
+			std::vector<word_t> last(row(height-1), row(height-1) + stride);
+			size_t band_begin = 0U;
+			for (size_t y = 0; y < height; ++y) {
+				const word_t* up = y == 0 ? last.data() : row(y-1);
+				const word_t* dn = y == height-1 ? first.data() : row(y+1);
+				kernel(up, row(y), dn, sub_row(y));
+				/* row y is still the upper neighbour of y+1 */
+				if (y + 1 - band_begin >= band_rows + 1U) {
+					release(band_begin, y);
+					band_begin = y;
+				}
+			}
+			release(band_begin, height);
+			swap();
+			++header()->generation;
+		}
+
+		////////////////////////////////////////////////////////////
+		uint64_t Generation() const noexcept {
+			return header()->generation;
+		}
+
+		////////////////////////////////////////////////////////////
+		void setGeneration(uint64_t generation) noexcept {
+			header()->generation = generation;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t population() const noexcept {
+			size_t counter = 0U;
+			const word_t* p = front_plane();
+			for (size_t i = 0; i < plane_words(); ++i) {
+				counter += __builtin_popcountll(p[i]);
+			}
+			return counter;
+		}
+	};
+
+	typedef BasicMappedLife<rules::Life> MappedLife;
+}
+
+#endif
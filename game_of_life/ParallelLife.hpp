@@ -0,0 +1,181 @@
+#ifndef PARALLEL_LIFE_SO2U
+#define PARALLEL_LIFE_SO2U
+
+#include "mewall.h"
+#include "BitBuffer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mew::game {
+	// BitBuffer2d stepped by a pool of threads, one horizontal band each.
+	// During a generation every band reads its own rows plus one halo row
+	// above and below from the front buffer (read-only) and writes only
+	// its rows of the back buffer; the barrier completion swaps buffers.
+	// The row kernel is the one BitBuffer2d::step() uses, so the result
+	// matches single-thread stepping bit for bit.
+	template<typename Rule = rules::Life>
+	class BasicParallelLife {
+	private:
+		struct SwapBuffers {
+			BasicBitBuffer2d<Rule>* board;
+			void operator()() noexcept { board->swap(); }
+		};
+
+		BasicBitBuffer2d<Rule> board;
+		size_t thread_count = 1U;
+		std::vector<std::thread> workers;
+		std::unique_ptr<std::barrier<>> start_barrier;
+		std::unique_ptr<std::barrier<SwapBuffers>> generation_barrier;
+		std::atomic<size_t> generations{0U};
+		std::atomic<bool> stopping{false};
+
+		////////////////////////////////////////////////////////////
+		size_t band_begin(size_t band) const noexcept {
+			return board.Height() * band / thread_count;
+		}
+
+		////////////////////////////////////////////////////////////
+		void run_band(size_t band) {
+			const size_t y0 = band_begin(band), y1 = band_begin(band + 1);
+			const size_t count = generations.load(std::memory_order_acquire);
+			for (size_t g = 0; g < count; ++g) {
+				board.stepRows(y0, y1);
+				generation_barrier->arrive_and_wait();
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		void worker(size_t band) {
+			for (;;) {
+				start_barrier->arrive_and_wait();
+				if (stopping.load(std::memory_order_acquire)) { return; }
+				run_band(band);
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		void start_pool() {
+			if (thread_count <= 1) { return; }
+			stopping = false;
+			start_barrier = std::make_unique<std::barrier<>>(thread_count);
+			generation_barrier = std::make_unique<std::barrier<SwapBuffers>>(
+				thread_count, SwapBuffers{&board});
+			/* band 0 runs on the calling thread */
+			for (size_t band = 1; band < thread_count; ++band) {
+				workers.emplace_back(&BasicParallelLife::worker, this, band);
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		void stop_pool() {
+			if (workers.empty()) { return; }
+			stopping = true;
+			start_barrier->arrive_and_wait();
+			for (std::thread& t: workers) {
+				t.join();
+			}
+			workers.clear();
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		BasicParallelLife() {}
+
+		////////////////////////////////////////////////////////////
+		BasicParallelLife(size_t _w, size_t _h, size_t _threads = 0U): board(_w, _h) {
+			setThreads(_threads);
+		}
+
+		////////////////////////////////////////////////////////////
+		~BasicParallelLife() {
+			stop_pool();
+		}
+
+		BasicParallelLife(const BasicParallelLife&) = delete;
+		BasicParallelLife& operator=(const BasicParallelLife&) = delete;
+
+		////////////////////////////////////////////////////////////
+		// 0 picks one thread per hardware core
+		void setThreads(size_t count) {
+			stop_pool();
+			if (count == 0) {
+				count = std::max<size_t>(1U, std::thread::hardware_concurrency());
+			}
+			thread_count = std::min(count, std::max<size_t>(1U, board.Height()));
+			start_pool();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Threads() const noexcept {
+			return thread_count;
+		}
+
+		////////////////////////////////////////////////////////////
+		void clear(byte val) {
+			board.clear(val);
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return board.Width();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return board.Height();
+		}
+
+		////////////////////////////////////////////////////////////
+		void set(size_t x, size_t y, byte val) {
+			board.set(x, y, val);
+		}
+
+		////////////////////////////////////////////////////////////
+		byte get(size_t x, size_t y) const {
+			return board.get(x, y);
+		}
+
+		////////////////////////////////////////////////////////////
+		void sync() {
+			board.sync();
+		}
+
+		////////////////////////////////////////////////////////////
+		void apply() {
+			board.apply();
+		}
+
+		////////////////////////////////////////////////////////////
+		const BasicBitBuffer2d<Rule>& Board() const noexcept {
+			return board;
+		}
+
+		////////////////////////////////////////////////////////////
+		// advances `count` generations; the pool stays parked on the
+		// start barrier between calls
+		void step(size_t count = 1U) {
+			if (thread_count <= 1) {
+				for (size_t g = 0; g < count; ++g) {
+					board.step();
+				}
+				return;
+			}
+			generations.store(count, std::memory_order_release);
+			start_barrier->arrive_and_wait();
+			run_band(0);
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t population() const noexcept {
+			return board.population();
+		}
+	};
+
+	typedef BasicParallelLife<rules::Life> ParallelLife;
+}
+
+#endif
@@ -0,0 +1,688 @@
+#ifndef PATTERN_SO2U
+#define PATTERN_SO2U
+
+#include "mewall.h"
+#include "BitBuffer.hpp"
+#include "HashLife.hpp"
+#include <stdint.h>
+#include <string.h>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Streaming readers and writers for the common Life pattern formats:
+//   RLE        "x = 3, y = 3, rule = B3/S23" + "bo$2bo$3o!"
+//   macrocell  "[M2]" quadtree dump, 8x8 leaves and "k nw ne sw se" nodes
+//   plaintext  ".cells", '!' comments, 'O' alive
+// Cells are written straight into the engine's staged buffer (set/apply),
+// macrocell into HashLife nodes; input is read in fixed chunks and output
+// goes through one preallocated buffer, no per-line strings are built.
+
+namespace mew::game {
+	struct PatternInfo {
+		size_t width = 0U, height = 0U;
+		uint64_t generation = 0U;
+		byte states = 2;
+		std::string rule;
+	};
+
+	////////////////////////////////////////////////////////////
+	// chunked reader over std::istream
+	class PatternReader {
+	private:
+		std::istream& in;
+		std::vector<char> buffer;
+		size_t pos = 0U, end = 0U;
+
+		////////////////////////////////////////////////////////////
+		bool fill() {
+			pos = 0U;
+			end = (size_t)in.rdbuf()->sgetn(buffer.data(), (std::streamsize)buffer.size());
+			return end > 0U;
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		PatternReader(std::istream& _in, size_t _chunk = 1U << 16): in(_in), buffer(_chunk) {}
+
+		////////////////////////////////////////////////////////////
+		int peek() {
+			if (pos == end && !fill()) { return EOF; }
+			return (unsigned char)buffer[pos];
+		}
+
+		////////////////////////////////////////////////////////////
+		int next() {
+			if (pos == end && !fill()) { return EOF; }
+			return (unsigned char)buffer[pos++];
+		}
+
+		////////////////////////////////////////////////////////////
+		void skipLine() {
+			int c;
+			while ((c = next()) != EOF && c != '\n') {}
+		}
+
+		////////////////////////////////////////////////////////////
+		void skipBlanks() {
+			int c;
+			while ((c = peek()) == ' ' || c == '\t' || c == '\r') { ++pos; }
+		}
+
+		////////////////////////////////////////////////////////////
+		// reads the rest of the line into a fixed buffer (headers only)
+		size_t readLine(char* out, size_t capacity) {
+			size_t n = 0U;
+			int c;
+			while ((c = next()) != EOF && c != '\n') {
+				if (c != '\r' && n + 1 < capacity) { out[n++] = (char)c; }
+			}
+			out[n] = 0;
+			return n;
+		}
+
+		////////////////////////////////////////////////////////////
+		bool readNumber(uint64_t& out) {
+			skipBlanks();
+			int c = peek();
+			if (c < '0' || c > '9') { return false; }
+			out = 0U;
+			while ((c = peek()) >= '0' && c <= '9') {
+				out = out*10U + (uint64_t)(c - '0');
+				++pos;
+			}
+			return true;
+		}
+	};
+
+	////////////////////////////////////////////////////////////
+	// preallocated output buffer, flushed to the stream when full
+	class PatternWriter {
+	private:
+		std::ostream& out;
+		std::vector<char> buffer;
+		size_t size = 0U;
+
+	public:
+		////////////////////////////////////////////////////////////
+		PatternWriter(std::ostream& _out, size_t _capacity = 1U << 16): out(_out), buffer(_capacity) {}
+
+		////////////////////////////////////////////////////////////
+		~PatternWriter() {
+			flush();
+		}
+
+		////////////////////////////////////////////////////////////
+		void put(char c) {
+			if (size == buffer.size()) { flush(); }
+			buffer[size++] = c;
+		}
+
+		////////////////////////////////////////////////////////////
+		void write(const char* str) {
+			while (*str) { put(*str++); }
+		}
+
+		////////////////////////////////////////////////////////////
+		// returns the number of characters written
+		size_t number(uint64_t value) {
+			char digits[24];
+			size_t n = 0U;
+			do {
+				digits[n++] = (char)('0' + value % 10U);
+				value /= 10U;
+			} while (value != 0U);
+			for (size_t i = n; i > 0; --i) { put(digits[i-1]); }
+			return n;
+		}
+
+		////////////////////////////////////////////////////////////
+		void flush() {
+			if (size == 0U) { return; }
+			out.write(buffer.data(), (std::streamsize)size);
+			size = 0U;
+		}
+
+		////////////////////////////////////////////////////////////
+		bool good() const {
+			return out.good();
+		}
+	};
+
+	namespace pattern {
+		////////////////////////////////////////////////////////////
+		template<typename Engine>
+		inline void PutCell(Engine& engine, int64_t x, int64_t y, byte val) {
+			if constexpr (requires { engine.setCell(x, y, val); }) {
+				engine.setCell(x, y, val);
+			} else {
+				if (x < 0 || y < 0 || (size_t)x >= engine.Width() || (size_t)y >= engine.Height()) { return; }
+				engine.set((size_t)x, (size_t)y, val);
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		template<typename Engine>
+		inline uint64_t GenerationOf(const Engine& engine, uint64_t fallback) {
+			if constexpr (requires { engine.Generation(); }) {
+				return engine.Generation();
+			} else {
+				return fallback;
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		template<typename Engine>
+		inline void SetGeneration(Engine& engine, uint64_t generation) {
+			if constexpr (requires { engine.setGeneration(generation); }) {
+				engine.setGeneration(generation);
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// bit-packed boards are read straight from their rows
+		template<typename Engine>
+		inline byte CellAt(Engine& engine, size_t x, size_t y) {
+			if constexpr (requires { engine.Stride(); }) {
+				if (x < engine.Width() && y < engine.Height()) {
+					return (byte)((engine.row(y)[x / bits::word_bits] >> (x % bits::word_bits)) & 1U);
+				}
+			}
+			return engine.get(x, y);
+		}
+
+		////////////////////////////////////////////////////////////
+		// "Gen=123" / "rule = B3/S23" style key lookups in a header line
+		inline const char* FindKey(const char* line, const char* key) {
+			size_t n = strlen(key);
+			for (const char* p = line; *p; ++p) {
+				if (strncmp(p, key, n) != 0) { continue; }
+				const char* v = p + n;
+				while (*v == ' ' || *v == '\t') { ++v; }
+				if (*v != '=') { continue; }
+				++v;
+				while (*v == ' ' || *v == '\t') { ++v; }
+				return v;
+			}
+			return nullptr;
+		}
+
+		////////////////////////////////////////////////////////////
+		// a ":T" topology suffix is dropped, boards wrap at their own size
+		inline void ReadRuleName(const char* p, std::string& rule) {
+			const char* e = p;
+			while (*e && *e != ',' && *e != ' ' && *e != '\t' && *e != ':') { ++e; }
+			rule.assign(p, e);
+		}
+
+		////////////////////////////////////////////////////////////
+		inline bool EndsWith(const char* str, const char* suffix) {
+			size_t n = strlen(str), m = strlen(suffix);
+			return n >= m && strcmp(str + n - m, suffix) == 0;
+		}
+
+		// one macrocell line: an 8x8 leaf bitmap (level 3, two states)
+		// or a node whose children are earlier line indices (0 = empty);
+		// level 1 lines of multi-state files hold the four cell states
+		struct MacroNode {
+			byte level = 0;
+			uint32_t child[4] = {0U, 0U, 0U, 0U};
+			uint64_t leaf = 0U;
+			bool bitmap = false;
+		};
+
+		////////////////////////////////////////////////////////////
+		// paints node `idx` with its top-left corner at (x, y)
+		template<typename Engine>
+		void PaintMacro(Engine& engine, const std::vector<MacroNode>& table, uint32_t idx, int64_t x, int64_t y) {
+			if (idx == 0U) { return; }
+			const MacroNode& n = table[idx];
+			if (x >= (int64_t)engine.Width() || y >= (int64_t)engine.Height()) { return; }
+			if (n.level == 1) {
+				for (size_t q = 0; q < 4; ++q) {
+					if (n.child[q] != 0U) {
+						PutCell(engine, x + (int64_t)(q & 1U), y + (int64_t)(q >> 1), (byte)n.child[q]);
+					}
+				}
+				return;
+			}
+			if (n.bitmap) {
+				for (uint64_t bits = n.leaf; bits != 0U; bits &= bits - 1U) {
+					size_t b = (size_t)__builtin_ctzll(bits);
+					PutCell(engine, x + (int64_t)(b & 7U), y + (int64_t)(b >> 3), Alive);
+				}
+				return;
+			}
+			int64_t half = (int64_t)1 << (n.level - 1);
+			PaintMacro(engine, table, n.child[0], x, y);
+			PaintMacro(engine, table, n.child[1], x + half, y);
+			PaintMacro(engine, table, n.child[2], x, y + half);
+			PaintMacro(engine, table, n.child[3], x + half, y + half);
+		}
+
+		////////////////////////////////////////////////////////////
+		// level-`level` HashLife node from the sub-square of an 8x8 leaf
+		template<typename Node, typename Life>
+		Node* LeafNode(Life& life, uint64_t leaf, size_t x, size_t y, byte level) {
+			if (level == 0) {
+				return life.Leaf(((leaf >> (y*8 + x)) & 1U) ? Alive : Dead);
+			}
+			size_t half = (size_t)1 << (level - 1);
+			return life.MakeNode(
+				LeafNode<Node>(life, leaf, x, y, level - 1), LeafNode<Node>(life, leaf, x + half, y, level - 1),
+				LeafNode<Node>(life, leaf, x, y + half, level - 1), LeafNode<Node>(life, leaf, x + half, y + half, level - 1)
+			);
+		}
+
+		////////////////////////////////////////////////////////////
+		// cell (x, y) of a HashLife node, x and y from its top-left
+		template<typename Node>
+		byte NodeCell(const Node* n, size_t x, size_t y) {
+			while (n->level > 0) {
+				if (n->population == 0U) { return Dead; }
+				size_t half = (size_t)1 << (n->level - 1);
+				bool east = x >= half, south = y >= half;
+				n = south ? (east ? n->se : n->sw) : (east ? n->ne : n->nw);
+				if (east) { x -= half; }
+				if (south) { y -= half; }
+			}
+			return n->population != 0U ? Alive : Dead;
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	// RLE header lines ('#' comments, "#CXRLE Gen=", "x = .., y = ..")
+	// up to the first body character; returns false on a missing "x =" line
+	inline bool ReadRLEHeader(PatternReader& reader, PatternInfo& info) {
+		char line[512];
+		for (;;) {
+			reader.skipBlanks();
+			int c = reader.peek();
+			if (c == EOF) { return false; }
+			if (c == '\n') { reader.next(); continue; }
+			if (c == '#') {
+				reader.readLine(line, sizeof(line));
+				if (line[1] == 'r') {
+					const char* p = line + 2;
+					while (*p == ' ') { ++p; }
+					pattern::ReadRuleName(p, info.rule);
+				} else if (strncmp(line, "#CXRLE", 6) == 0) {
+					const char* gen = strstr(line, "Gen=");
+					if (gen != nullptr) { info.generation = strtoull(gen + 4, nullptr, 10); }
+				}
+				continue;
+			}
+			if (c != 'x') { return false; }
+			reader.readLine(line, sizeof(line));
+			const char* w = pattern::FindKey(line, "x");
+			const char* h = pattern::FindKey(line, "y");
+			const char* rule = pattern::FindKey(line, "rule");
+			if (w == nullptr || h == nullptr) { return false; }
+			info.width = strtoull(w, nullptr, 10);
+			info.height = strtoull(h, nullptr, 10);
+			if (rule != nullptr) { pattern::ReadRuleName(rule, info.rule); }
+			return true;
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	// live cells of an RLE pattern painted at (ox, oy); dead runs are
+	// skipped so the pattern is laid over whatever the board holds
+	template<typename Engine>
+	bool LoadRLE(Engine& engine, std::istream& in, PatternInfo* info = nullptr, int64_t ox = 0, int64_t oy = 0) {
+		PatternReader reader(in);
+		PatternInfo header;
+		if (!ReadRLEHeader(reader, header)) { return false; }
+		engine.sync();
+		int64_t x = 0, y = 0;
+		byte prefix = 0;
+		uint64_t count = 1U;
+		bool done = false;
+		while (!done) {
+			/* the count of "3pB" comes before the p..y prefix */
+			if (prefix == 0) {
+				count = 1U;
+				reader.readNumber(count);
+			}
+			int c = reader.next();
+			switch (c) {
+				case EOF: case '!': done = true; break;
+				case ' ': case '\t': case '\r': case '\n': break;
+				case 'b': case '.': x += (int64_t)count; prefix = 0; break;
+				case '$': y += (int64_t)count; x = 0; prefix = 0; break;
+				case '#': reader.skipLine(); break;
+				default: {
+					byte val = Alive;
+					if (c >= 'p' && c <= 'y') {
+						prefix = (byte)(c - 'p' + 1);
+						continue;
+					}
+					if (c >= 'A' && c <= 'X') {
+						val = (byte)(prefix*24 + (c - 'A') + 1);
+					} else if (c < 'a' || c > 'z') {
+						return false;
+					}
+					prefix = 0;
+					for (uint64_t i = 0; i < count; ++i) {
+						pattern::PutCell(engine, ox + x + (int64_t)i, oy + y, val);
+					}
+					x += (int64_t)count;
+				}
+			}
+		}
+		engine.apply();
+		pattern::SetGeneration(engine, header.generation);
+		if (info != nullptr) { *info = header; }
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////
+	// "[M2]" header, "#R rule" and "#G generation" lines
+	inline bool ReadMacrocellHeader(PatternReader& reader, PatternInfo& info) {
+		char line[512];
+		if (reader.peek() != '[') { return false; }
+		reader.readLine(line, sizeof(line));
+		if (strncmp(line, "[M2]", 4) != 0) { return false; }
+		while (reader.peek() == '#') {
+			reader.readLine(line, sizeof(line));
+			const char* p = line + 2;
+			while (*p == ' ') { ++p; }
+			if (line[1] == 'R') { pattern::ReadRuleName(p, info.rule); }
+			else if (line[1] == 'G') { info.generation = strtoull(p, nullptr, 10); }
+		}
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////
+	inline bool ReadMacrocellNodes(PatternReader& reader, std::vector<pattern::MacroNode>& table, PatternInfo& info) {
+		table.assign(1U, pattern::MacroNode());
+		for (;;) {
+			int c = reader.peek();
+			if (c == EOF) { break; }
+			if (c == '\n' || c == '\r') { reader.next(); continue; }
+			if (c == '#') { reader.skipLine(); continue; }
+			pattern::MacroNode n;
+			if (c == '.' || c == '*' || c == '$') {
+				size_t x = 0U, y = 0U;
+				while ((c = reader.next()) != EOF && c != '\n') {
+					if (c == '$') { ++y; x = 0U; }
+					else if (c == '.') { ++x; }
+					else if (c == '*') {
+						if (x >= 8U || y >= 8U) { return false; }
+						n.leaf |= (uint64_t)1 << (y*8 + x++);
+					}
+				}
+				n.level = 3;
+				n.bitmap = true;
+			} else {
+				uint64_t level = 0U, child = 0U;
+				if (!reader.readNumber(level) || level == 0U || level > 63U) { return false; }
+				n.level = (byte)level;
+				for (size_t q = 0; q < 4; ++q) {
+					if (!reader.readNumber(child)) { return false; }
+					if (level > 1U && child >= table.size()) { return false; }
+					n.child[q] = (uint32_t)child;
+					if (level == 1U && child + 1U > info.states) { info.states = (byte)(child + 1U); }
+				}
+				reader.skipLine();
+			}
+			table.push_back(n);
+		}
+		return table.size() > 1U;
+	}
+
+	////////////////////////////////////////////////////////////
+	// the macrocell format has no origin: the top-left corner of the
+	// root square lands on (ox, oy)
+	template<typename Engine>
+	bool LoadMacrocell(Engine& engine, std::istream& in, PatternInfo* info = nullptr, int64_t ox = 0, int64_t oy = 0) {
+		PatternReader reader(in);
+		PatternInfo header;
+		std::vector<pattern::MacroNode> table;
+		if (!ReadMacrocellHeader(reader, header) || !ReadMacrocellNodes(reader, table, header)) { return false; }
+		uint32_t root = (uint32_t)(table.size() - 1U);
+		header.width = header.height = (size_t)1 << table[root].level;
+		engine.sync();
+		pattern::PaintMacro(engine, table, root, ox, oy);
+		engine.apply();
+		pattern::SetGeneration(engine, header.generation);
+		if (info != nullptr) { *info = header; }
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////
+	// HashLife: nodes are built directly, replacing the universe
+	template<typename Rule>
+	bool LoadMacrocell(BasicHashLife<Rule>& life, std::istream& in, PatternInfo* info = nullptr) {
+		typedef typename BasicHashLife<Rule>::Node Node;
+		PatternReader reader(in);
+		PatternInfo header;
+		std::vector<pattern::MacroNode> table;
+		if (!ReadMacrocellHeader(reader, header) || !ReadMacrocellNodes(reader, table, header)) { return false; }
+		std::vector<Node*> built(table.size(), nullptr);
+		for (size_t i = 1; i < table.size(); ++i) {
+			const pattern::MacroNode& n = table[i];
+			if (n.level == 1) {
+				built[i] = life.MakeNode(
+					life.Leaf(n.child[0] ? Alive : Dead), life.Leaf(n.child[1] ? Alive : Dead),
+					life.Leaf(n.child[2] ? Alive : Dead), life.Leaf(n.child[3] ? Alive : Dead));
+			} else if (n.bitmap) {
+				built[i] = pattern::LeafNode<Node>(life, n.leaf, 0, 0, 3);
+			} else {
+				Node* q[4];
+				for (size_t k = 0; k < 4; ++k) {
+					q[k] = n.child[k] == 0U ? life.EmptyNode(n.level - 1) : built[n.child[k]];
+					if (q[k]->level != n.level - 1) { return false; }
+				}
+				built[i] = life.MakeNode(q[0], q[1], q[2], q[3]);
+			}
+		}
+		Node* root = built.back();
+		header.width = header.height = (size_t)1 << root->level;
+		life.setRoot(root);
+		life.setGeneration(header.generation);
+		if (info != nullptr) { *info = header; }
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////
+	// plaintext (.cells): '!' comment lines, 'O' or '*' alive
+	template<typename Engine>
+	bool LoadPlaintext(Engine& engine, std::istream& in, PatternInfo* info = nullptr, int64_t ox = 0, int64_t oy = 0) {
+		PatternReader reader(in);
+		PatternInfo header;
+		engine.sync();
+		int64_t x = 0, y = 0;
+		int c;
+		bool comment = false, line_start = true;
+		while ((c = reader.next()) != EOF) {
+			if (c == '\n') {
+				if (!comment) {
+					if (x > (int64_t)header.width) { header.width = (size_t)x; }
+					++y;
+				}
+				x = 0;
+				comment = false;
+				line_start = true;
+				continue;
+			}
+			if (line_start && c == '!') { comment = true; }
+			line_start = false;
+			if (comment || c == '\r') { continue; }
+			if (c == 'O' || c == '*') { pattern::PutCell(engine, ox + x, oy + y, Alive); }
+			++x;
+		}
+		header.height = (size_t)y + (x > 0 ? 1U : 0U);
+		engine.apply();
+		if (info != nullptr) { *info = header; }
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////
+	// RLE of the info.width x info.height window at (x0, y0);
+	// a zero size saves the engine's whole Width() x Height()
+	template<typename Engine>
+	bool SaveRLE(Engine& engine, std::ostream& os, const PatternInfo& info, size_t x0 = 0U, size_t y0 = 0U) {
+		constexpr size_t line_limit = 70U;
+		const size_t width = info.width != 0U ? info.width : engine.Width();
+		const size_t height = info.height != 0U ? info.height : engine.Height();
+		const bool multi = info.states > 2;
+		PatternWriter out(os);
+		out.write("#CXRLE Gen=");
+		out.number(pattern::GenerationOf(engine, info.generation));
+		out.write("\nx = ");
+		out.number(width);
+		out.write(", y = ");
+		out.number(height);
+		out.write(", rule = ");
+		out.write(info.rule.empty() ? "B3/S23" : info.rule.c_str());
+		out.put('\n');
+		size_t column = 0U;
+		auto token = [&](uint64_t count, const char* sym, size_t len) {
+			size_t digits = 0U;
+			for (uint64_t v = count; count > 1U && v != 0U; v /= 10U) { ++digits; }
+			if (column + digits + len > line_limit) {
+				out.put('\n');
+				column = 0U;
+			}
+			if (count > 1U) { out.number(count); }
+			for (size_t i = 0; i < len; ++i) { out.put(sym[i]); }
+			column += digits + len;
+		};
+		auto cells = [&](uint64_t count, byte val) {
+			char sym[2];
+			size_t len = 1U;
+			if (!multi) { sym[0] = IsDead(val) ? 'b' : 'o'; }
+			else if (IsDead(val)) { sym[0] = '.'; }
+			else if (val <= 24) { sym[0] = (char)('A' + val - 1); }
+			else {
+				sym[0] = (char)('p' + (val - 25) / 24);
+				sym[1] = (char)('A' + (val - 25) % 24);
+				len = 2U;
+			}
+			token(count, sym, len);
+		};
+		uint64_t rows = 0U;
+		for (size_t y = 0; y < height; ++y) {
+			byte run_val = Dead;
+			uint64_t run = 0U;
+			bool row_used = false;
+			for (size_t x = 0; x < width; ++x) {
+				byte val = pattern::CellAt(engine, x0 + x, y0 + y);
+				if (val == run_val) { ++run; continue; }
+				if (!row_used) {
+					if (rows > 0U) { token(rows, "$", 1U); }
+					rows = 0U;
+					row_used = true;
+				}
+				if (run > 0U) { cells(run, run_val); }
+				run_val = val;
+				run = 1U;
+			}
+			/* trailing dead cells are implied */
+			if (run > 0U && !IsDead(run_val)) { cells(run, run_val); }
+			++rows;
+		}
+		out.write("!\n");
+		out.flush();
+		return out.good();
+	}
+
+	////////////////////////////////////////////////////////////
+	// macrocell dump of the whole HashLife universe, children first
+	template<typename Rule>
+	bool SaveMacrocell(const BasicHashLife<Rule>& life, std::ostream& os, const PatternInfo& info) {
+		typedef typename BasicHashLife<Rule>::Node Node;
+		PatternWriter out(os);
+		out.write("[M2] (mew game_of_life)\n#R ");
+		out.write(info.rule.empty() ? "B3/S23" : info.rule.c_str());
+		out.write("\n#G ");
+		out.number(life.Generation());
+		out.put('\n');
+		std::unordered_map<const Node*, uint64_t> index;
+		uint64_t count = 0U;
+		auto write_node = [&](auto& self, const Node* n) -> uint64_t {
+			if (n->population == 0U) { return 0U; }
+			auto it = index.find(n);
+			if (it != index.end()) { return it->second; }
+			if (n->level == 3) {
+				size_t rows = 0U;
+				for (size_t y = 0; y < 8; ++y) {
+					for (size_t x = 0; x < 8; ++x) {
+						if (IsAlive(pattern::NodeCell(n, x, y))) { rows = y + 1; }
+					}
+				}
+				/* trailing dead cells and rows are implied */
+				for (size_t y = 0; y < rows; ++y) {
+					size_t last = 0U;
+					for (size_t x = 0; x < 8; ++x) {
+						if (IsAlive(pattern::NodeCell(n, x, y))) { last = x + 1; }
+					}
+					for (size_t x = 0; x < last; ++x) {
+						out.put(IsAlive(pattern::NodeCell(n, x, y)) ? '*' : '.');
+					}
+					out.put('$');
+				}
+			} else {
+				uint64_t nw = self(self, n->nw), ne = self(self, n->ne);
+				uint64_t sw = self(self, n->sw), se = self(self, n->se);
+				out.number(n->level);
+				out.put(' '); out.number(nw);
+				out.put(' '); out.number(ne);
+				out.put(' '); out.number(sw);
+				out.put(' '); out.number(se);
+			}
+			out.put('\n');
+			index.emplace(n, ++count);
+			return count;
+		};
+		const Node* root = life.Root();
+		if (root->population == 0U) {
+			/* an empty universe still needs one node line */
+			out.write("$\n");
+		} else {
+			write_node(write_node, root);
+		}
+		out.flush();
+		return out.good();
+	}
+
+	////////////////////////////////////////////////////////////
+	// header only, to pick a rule/engine before loading
+	inline bool ReadPatternInfo(const char* path, PatternInfo& info) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) { return false; }
+		PatternReader reader(file, 4096U);
+		if (pattern::EndsWith(path, ".mc")) { return ReadMacrocellHeader(reader, info); }
+		if (pattern::EndsWith(path, ".rle")) { return ReadRLEHeader(reader, info); }
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////
+	// format picked by extension: .rle, .mc, otherwise plaintext
+	template<typename Engine>
+	bool LoadPattern(Engine& engine, const char* path, PatternInfo* info = nullptr) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) { return false; }
+		if (pattern::EndsWith(path, ".rle")) { return LoadRLE(engine, file, info); }
+		if (pattern::EndsWith(path, ".mc")) { return LoadMacrocell(engine, file, info); }
+		return LoadPlaintext(engine, file, info);
+	}
+
+	////////////////////////////////////////////////////////////
+	// checkpoint: macrocell for HashLife (".mc"), RLE otherwise
+	template<typename Engine>
+	bool SavePattern(Engine& engine, const char* path, const PatternInfo& info) {
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open()) { return false; }
+		if constexpr (requires { engine.Root(); }) {
+			if (pattern::EndsWith(path, ".mc")) { return SaveMacrocell(engine, file, info); }
+		}
+		return SaveRLE(engine, file, info);
+	}
+}
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef RULE_SO2U
+#define RULE_SO2U
+
+#include "mewall.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <array>
+#include <string>
+#include <vector>
+
+#define Alive (byte)1
+#define Dead (byte)0
+#define IsAlive(cr) ((cr)==Alive)
+#define IsDead(cr) ((cr)==Dead)
+
+namespace mew::game {
+	namespace rules {
+		////////////////////////////////////////////////////////////
+		// Generations semantics: 0 dead, 1 alive, 2..states-1 dying.
+		// Only state 1 counts as a live neighbor; a dying cell always
+		// moves to the next state and finally back to 0.
+		constexpr byte Transition(byte current, bool born, bool survives, byte states) {
+			if (current == 0) { return born ? 1 : 0; }
+			if (current == 1 && survives) { return 1; }
+			return (byte)((current + 1) % states);
+		}
+
+		enum Neighborhood: byte {
+			Moore, VonNeumann,
+		};
+
+		// Outer-totalistic Moore radius-1 rule known at compile time.
+		// Bit n of Birth/Survive means "n live neighbors"; the transition
+		// is a constexpr table so stepping is a branch-free lookup.
+		template<uint32_t Birth, uint32_t Survive, byte States = 2>
+		struct StaticRule {
+			static_assert(States >= 2, "a rule needs at least two states");
+			static constexpr uint32_t birth = Birth;
+			static constexpr uint32_t survive = Survive;
+			static constexpr byte states = States;
+			static constexpr byte radius = 1;
+			static constexpr bool count_center = false;
+			static constexpr Neighborhood neighborhood = Moore;
+			static constexpr size_t max_neighbors = 8U;
+
+			////////////////////////////////////////////////////////////
+			static constexpr std::array<byte, States*9> MakeTable() {
+				std::array<byte, States*9> t = {};
+				for (size_t s = 0; s < States; ++s) {
+					for (size_t n = 0; n <= 8; ++n) {
+						t[s*9 + n] = Transition((byte)s, (Birth >> n) & 1U, (Survive >> n) & 1U, States);
+					}
+				}
+				return t;
+			}
+
+			static constexpr std::array<byte, States*9> table = MakeTable();
+
+			////////////////////////////////////////////////////////////
+			static constexpr byte next(byte current, size_t neighbors) noexcept {
+				return table[current*9 + neighbors];
+			}
+		};
+
+		typedef StaticRule<(1U<<3), (1U<<2)|(1U<<3)> Life;
+		typedef StaticRule<(1U<<3)|(1U<<6), (1U<<2)|(1U<<3)> HighLife;
+		typedef StaticRule<(1U<<3)|(1U<<6)|(1U<<7)|(1U<<8),
+			(1U<<3)|(1U<<4)|(1U<<6)|(1U<<7)|(1U<<8)> DayAndNight;
+		typedef StaticRule<(1U<<2), 0U, 3> BriansBrain;
+
+		// Rule parsed at runtime. Understands
+		//   B/S        "B3/S23", "B36/S23", "23/3" (S/B)
+		//   Generations "B2/S/C3", "/2/3" (S/B/C)
+		//   Larger than Life "R5,C0,M1,S34..58,B34..45,NM"
+		// and flattens it into a (state, neighbors) -> state table.
+		class Rule {
+		public:
+			byte states = 2;
+			byte radius = 1;
+			bool count_center = false;
+			Neighborhood neighborhood = Moore;
+			size_t max_neighbors = 8U;
+			std::vector<byte> table;
+			std::string name;
+
+			////////////////////////////////////////////////////////////
+			Rule(): name("B3/S23") {
+				std::vector<bool> birth(9, false), survive(9, false);
+				birth[3] = true;
+				survive[2] = survive[3] = true;
+				build(birth, survive);
+			}
+
+			////////////////////////////////////////////////////////////
+			byte next(byte current, size_t neighbors) const noexcept {
+				return table[current*(max_neighbors+1) + neighbors];
+			}
+
+			////////////////////////////////////////////////////////////
+			static Rule Parse(const char* str, bool* ok = nullptr) {
+				Rule rule;
+				bool parsed = Parse(str, rule);
+				if (ok != nullptr) { *ok = parsed; }
+				return rule;
+			}
+
+			////////////////////////////////////////////////////////////
+			static bool Parse(const char* str, Rule& rule) {
+				std::vector<bool> birth, survive;
+				Rule parsed;
+				bool ok = (str != nullptr) && (toupper(str[0]) == 'R')
+					? parse_ltl(str, parsed, birth, survive)
+					: parse_bs(str, parsed, birth, survive);
+				if (!ok) { return false; }
+				parsed.name = str;
+				parsed.build(birth, survive);
+				rule = parsed;
+				return true;
+			}
+
+		private:
+			////////////////////////////////////////////////////////////
+			void build(const std::vector<bool>& birth, const std::vector<bool>& survive) {
+				table.assign(states*(max_neighbors+1), 0);
+				for (size_t s = 0; s < states; ++s) {
+					for (size_t n = 0; n <= max_neighbors; ++n) {
+						table[s*(max_neighbors+1) + n] = Transition((byte)s,
+							n < birth.size() && birth[n], n < survive.size() && survive[n], states);
+					}
+				}
+			}
+
+			////////////////////////////////////////////////////////////
+			static bool read_digits(const char*& p, std::vector<bool>& set) {
+				set.assign(9, false);
+				while (isdigit(*p)) {
+					if (*p == '9') { return false; }
+					set[*p - '0'] = true;
+					++p;
+				}
+				return true;
+			}
+
+			////////////////////////////////////////////////////////////
+			static bool read_number(const char*& p, size_t& out) {
+				if (!isdigit(*p)) { return false; }
+				char* end = nullptr;
+				out = strtoul(p, &end, 10);
+				p = end;
+				return true;
+			}
+
+			////////////////////////////////////////////////////////////
+			static bool parse_bs(const char* p, Rule& rule, std::vector<bool>& birth, std::vector<bool>& survive) {
+				if (p == nullptr) { return false; }
+				rule.states = 2;
+				if (toupper(*p) == 'B' || toupper(*p) == 'S') {
+					/* B../S..[/C..] in either order */
+					bool has_b = false, has_s = false;
+					while (*p) {
+						char c = toupper(*p++);
+						if (c == 'B' && !has_b) { has_b = read_digits(p, birth); if (!has_b) { return false; } }
+						else if (c == 'S' && !has_s) { has_s = read_digits(p, survive); if (!has_s) { return false; } }
+						else if (c == 'C' || c == 'G') {
+							size_t states = 0;
+							if (!read_number(p, states) || states < 2 || states > 255) { return false; }
+							rule.states = (byte)states;
+						}
+						else { return false; }
+						if (*p == '/') { ++p; }
+					}
+					return has_b && has_s;
+				}
+				/* S/B[/C] */
+				if (!read_digits(p, survive) || *p++ != '/') { return false; }
+				if (!read_digits(p, birth)) { return false; }
+				if (*p == '/') {
+					++p;
+					size_t states = 0;
+					if (!read_number(p, states) || states < 2 || states > 255) { return false; }
+					rule.states = (byte)states;
+				}
+				return *p == 0;
+			}
+
+			////////////////////////////////////////////////////////////
+			static bool read_range(const char*& p, std::vector<bool>& set, size_t max_n) {
+				size_t lo = 0, hi = 0;
+				if (!read_number(p, lo)) { return false; }
+				hi = lo;
+				if (p[0] == '.' && p[1] == '.') {
+					p += 2;
+					if (!read_number(p, hi)) { return false; }
+				} else if (*p == '-') {
+					++p;
+					if (!read_number(p, hi)) { return false; }
+				}
+				if (lo > hi || hi > max_n) { return false; }
+				set.assign(max_n+1, false);
+				for (size_t n = lo; n <= hi; ++n) { set[n] = true; }
+				return true;
+			}
+
+			////////////////////////////////////////////////////////////
+			static bool parse_ltl(const char* p, Rule& rule, std::vector<bool>& birth, std::vector<bool>& survive) {
+				size_t radius = 1, states = 0, middle = 0;
+				const char* s_spec = nullptr;
+				const char* b_spec = nullptr;
+				rule.neighborhood = Moore;
+				while (*p) {
+					char c = toupper(*p++);
+					switch (c) {
+						case 'R': if (!read_number(p, radius) || radius == 0 || radius > 50) { return false; } break;
+						case 'C': if (!read_number(p, states) || states > 255) { return false; } break;
+						case 'M': if (!read_number(p, middle) || middle > 1) { return false; } break;
+						case 'S': s_spec = p; while (*p && *p != ',') { ++p; } break;
+						case 'B': b_spec = p; while (*p && *p != ',') { ++p; } break;
+						case 'N':
+							if (toupper(*p) == 'M') { rule.neighborhood = Moore; }
+							else if (toupper(*p) == 'N') { rule.neighborhood = VonNeumann; }
+							else { return false; }
+							++p;
+						break;
+						default: return false;
+					}
+					if (*p == ',') { ++p; }
+					else if (*p != 0) { return false; }
+				}
+				if (s_spec == nullptr || b_spec == nullptr) { return false; }
+				rule.radius = (byte)radius;
+				rule.states = states < 2 ? 2 : (byte)states;
+				rule.count_center = middle == 1;
+				size_t r = radius;
+				rule.max_neighbors = rule.neighborhood == Moore
+					? (2*r+1)*(2*r+1)
+					: 2*r*(r+1) + 1;
+				return read_range(s_spec, survive, rule.max_neighbors)
+					&& read_range(b_spec, birth, rule.max_neighbors);
+			}
+		};
+
+		////////////////////////////////////////////////////////////
+		// true when a parsed rule is the compile-time rule S
+		template<typename S>
+		bool Matches(const Rule& rule) {
+			if (rule.states != S::states || rule.radius != 1 ||
+				rule.neighborhood != Moore || rule.count_center) {
+				return false;
+			}
+			for (size_t s = 0; s < S::states; ++s) {
+				for (size_t n = 0; n <= 8; ++n) {
+					if (rule.next((byte)s, n) != S::next((byte)s, n)) { return false; }
+				}
+			}
+			return true;
+		}
+	}
+
+	////////////////////////////////////////////////////////////
+	// B3/S23: next state of a cell from its state and live neighbors
+	constexpr byte NextCell(byte current, size_t neighbors) {
+		return rules::Life::next(current, neighbors);
+	}
+}
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef RULE_ENGINE_SO2U
+#define RULE_ENGINE_SO2U
+
+#include "mewall.h"
+#include "Rule.hpp"
+#include <stdint.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace mew::game {
+	// Byte-per-cell board for any rule: B/S, multi-state Generations and
+	// Larger than Life radii. With a compile-time rule (rules::StaticRule)
+	// the transition table is constexpr and the radius-1 loop is fully
+	// specialized; rules::Rule drives the same loops from a runtime table.
+	template<typename RuleT = rules::Rule>
+	class RuleEngine {
+	private:
+		size_t width = 0U, height = 0U;
+		RuleT rule;
+		std::vector<byte> _main_buffer;
+		std::vector<byte> _sub_buffer;
+		std::vector<uint32_t> _scratch;
+
+		////////////////////////////////////////////////////////////
+		static uint32_t live(byte cell) noexcept {
+			return cell == Alive;
+		}
+
+		////////////////////////////////////////////////////////////
+		// Moore radius 1: three-row column sums, one lookup per cell
+		void step_moore() {
+			uint32_t* col = _scratch.data();
+			for (size_t y = 0; y < height; ++y) {
+				const byte* up = row((y + height - 1) % height);
+				const byte* md = row(y);
+				const byte* dn = row((y + 1) % height);
+				byte* out = sub_row(y);
+				for (size_t x = 0; x < width; ++x) {
+					col[x+1] = live(up[x]) + live(md[x]) + live(dn[x]);
+				}
+				col[0] = col[width];
+				col[width+1] = col[1];
+				for (size_t x = 0; x < width; ++x) {
+					uint32_t n = col[x] + col[x+1] + col[x+2];
+					if (!rule.count_center) { n -= live(md[x]); }
+					out[x] = rule.next(md[x], n);
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// any radius: wrapped row prefix sums, O(radius) per cell
+		void step_range() {
+			const size_t r = rule.radius;
+			const size_t span = width + 2*r + 1;
+			uint32_t* prefix = _scratch.data();
+			for (size_t y = 0; y < height; ++y) {
+				const byte* src = row(y);
+				uint32_t* p = prefix + y*span;
+				p[0] = 0;
+				for (size_t k = 0; k < width + 2*r; ++k) {
+					size_t x = (k + width*(r/width + 1) - r) % width;
+					p[k+1] = p[k] + live(src[x]);
+				}
+			}
+			for (size_t y = 0; y < height; ++y) {
+				const byte* md = row(y);
+				byte* out = sub_row(y);
+				for (size_t x = 0; x < width; ++x) {
+					uint32_t n = 0;
+					for (int dy = -(int)r; dy <= (int)r; ++dy) {
+						size_t yy = (y + height*(r/height + 1) + dy) % height;
+						size_t hw = rule.neighborhood == rules::Moore ? r : r - (size_t)(dy < 0 ? -dy : dy);
+						const uint32_t* p = prefix + yy*span;
+						n += p[x + r + hw + 1] - p[x + r - hw];
+					}
+					if (!rule.count_center) { n -= live(md[x]); }
+					out[x] = rule.next(md[x], n);
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		void reserve_scratch() {
+			if (rule.radius == 1 && rule.neighborhood == rules::Moore) {
+				_scratch.assign(width + 2, 0U);
+			} else {
+				_scratch.assign(height*(width + 2*rule.radius + 1), 0U);
+			}
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		RuleEngine() {}
+
+		////////////////////////////////////////////////////////////
+		RuleEngine(size_t _w, size_t _h)
+			: width(_w), height(_h), _main_buffer(_w*_h, Dead), _sub_buffer(_w*_h, Dead) {
+			reserve_scratch();
+		}
+
+		////////////////////////////////////////////////////////////
+		RuleEngine(size_t _w, size_t _h, const RuleT& _rule)
+			: width(_w), height(_h), rule(_rule), _main_buffer(_w*_h, Dead), _sub_buffer(_w*_h, Dead) {
+			reserve_scratch();
+		}
+
+		////////////////////////////////////////////////////////////
+		void setRule(const RuleT& _rule) {
+			rule = _rule;
+			reserve_scratch();
+		}
+
+		////////////////////////////////////////////////////////////
+		const RuleT& getRule() const noexcept {
+			return rule;
+		}
+
+		////////////////////////////////////////////////////////////
+		void clear(byte val) {
+			std::fill(_main_buffer.begin(), _main_buffer.end(), val);
+			std::fill(_sub_buffer.begin(), _sub_buffer.end(), val);
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t size() const noexcept {
+			return width*height;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return width;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return height;
+		}
+
+		////////////////////////////////////////////////////////////
+		const byte* row(size_t y) const noexcept {
+			return _main_buffer.data() + y*width;
+		}
+
+		////////////////////////////////////////////////////////////
+		byte* sub_row(size_t y) noexcept {
+			return _sub_buffer.data() + y*width;
+		}
+
+		////////////////////////////////////////////////////////////
+		void set(size_t x, size_t y, byte val) {
+			_sub_buffer[(y % height)*width + (x % width)] = val;
+		}
+
+		////////////////////////////////////////////////////////////
+		byte get(size_t x, size_t y) const {
+			return _main_buffer[(y % height)*width + (x % width)];
+		}
+
+		////////////////////////////////////////////////////////////
+		void sync() {
+			_sub_buffer = _main_buffer;
+		}
+
+		////////////////////////////////////////////////////////////
+		void apply() {
+			_main_buffer = _sub_buffer;
+		}
+
+		////////////////////////////////////////////////////////////
+		void swap() noexcept {
+			std::swap(_main_buffer, _sub_buffer);
+		}
+
+		////////////////////////////////////////////////////////////
+		// the sub buffer holds the previous generation afterwards,
+		// call sync() before staging edits
+		void step() {
+			if (rule.radius == 1 && rule.neighborhood == rules::Moore) {
+				step_moore();
+			} else {
+				step_range();
+			}
+			swap();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t population() const noexcept {
+			size_t counter = 0U;
+			for (byte cell: _main_buffer) {
+				counter += live(cell);
+			}
+			return counter;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef SIMULATION_SO2U
+#define SIMULATION_SO2U
+
+#include "mewall.h"
+#include "Engines.hpp"
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mew::game {
+	// Read-only copy of one generation, row-major.
+	struct Snapshot {
+		size_t width = 0U, height = 0U;
+		uint64_t generation = 0U;
+		double rate = 0.0;
+		TileStats tiles;
+		std::vector<byte> cells;
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return width;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return height;
+		}
+
+		////////////////////////////////////////////////////////////
+		byte get(size_t x, size_t y) const {
+			return cells[y*width + x];
+		}
+	};
+
+	// Steps an engine on its own thread at a target rate (generations per
+	// second, 0 = uncapped) and hands finished generations to the renderer
+	// through a triple buffer: the simulation fills the back slot, swaps
+	// it with the ready slot, and acquire() swaps ready with the front
+	// slot the renderer reads. A snapshot is only copied once the previous
+	// one was picked up, so an uncapped run pays for at most one copy per
+	// drawn frame. The engine itself is touched only under the mutex, by
+	// the simulation thread or inside edit().
+	template<typename Engine>
+	class Simulation {
+	private:
+		static constexpr unsigned fresh = 4U;
+
+		Engine& engine;
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable wake;
+		Snapshot slots[3];
+		std::atomic<unsigned> ready{1U};
+		unsigned back = 0U, front = 2U;
+		std::atomic<bool> stopping{false};
+		std::atomic<bool> paused{false};
+		std::atomic<double> target;
+		uint64_t rate_changes = 0U;     /* under the mutex */
+		std::atomic<size_t> editors{0U};
+		uint64_t generation = 0U;
+		uint64_t window_generation = 0U;
+		double measured = 0.0;
+		std::chrono::steady_clock::time_point window_begin;
+
+		////////////////////////////////////////////////////////////
+		uint64_t engine_generation() const {
+			if constexpr (requires { engine.Generation(); }) {
+				return engine.Generation();
+			} else {
+				return generation;
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// copy the engine into the back slot and make it the ready one
+		void publish() {
+			Snapshot& s = slots[back];
+			s.width = engine.Width();
+			s.height = engine.Height();
+			s.generation = engine_generation();
+			s.rate = measured;
+			if constexpr (requires { engine.Stats(); }) {
+				s.tiles = engine.Stats();
+			}
+			s.cells.resize(s.width*s.height);
+			for (size_t y = 0; y < s.height; ++y) {
+				byte* row = s.cells.data() + y*s.width;
+				for (size_t x = 0; x < s.width; ++x) {
+					row[x] = engine.get(x, y);
+				}
+			}
+			back = ready.exchange(back | fresh, std::memory_order_acq_rel) & 3U;
+		}
+
+		////////////////////////////////////////////////////////////
+		void measure() {
+			auto now = std::chrono::steady_clock::now();
+			double seconds = std::chrono::duration<double>(now - window_begin).count();
+			if (seconds >= 0.5) {
+				/* engine generations: a HashLife step can advance 2^k of them */
+				const uint64_t current = engine_generation();
+				if (current >= window_generation) {
+					measured = (double)(current - window_generation) / seconds;
+				}
+				window_generation = current;
+				window_begin = now;
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		void run() {
+			std::unique_lock<std::mutex> lock(mutex);
+			auto next = std::chrono::steady_clock::now();
+			window_begin = next;
+			window_generation = engine_generation();
+			while (!stopping.load(std::memory_order_acquire)) {
+				if (paused.load(std::memory_order_acquire)) {
+					wake.wait(lock, [&] { return stopping.load() || !paused.load(); });
+					next = std::chrono::steady_clock::now();
+					continue;
+				}
+				Step(engine);
+				++generation;
+				measure();
+				if ((ready.load(std::memory_order_acquire) & fresh) == 0U) {
+					publish();
+				}
+				double rate = target.load(std::memory_order_relaxed);
+				if (rate > 0.0) {
+					/* sleeps with the engine unlocked, so edits go through */
+					next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+						std::chrono::duration<double>(1.0 / rate));
+					auto now = std::chrono::steady_clock::now();
+					if (next < now) { next = now; }
+					const uint64_t seen = rate_changes;
+					wake.wait_until(lock, next, [&] {
+						return stopping.load() || paused.load() || rate_changes != seen;
+					});
+					/* a new rate restarts the schedule instead of finishing the old sleep */
+					if (rate_changes != seen) { next = std::chrono::steady_clock::now(); }
+				} else if (editors.load(std::memory_order_acquire) > 0U) {
+					lock.unlock();
+					std::this_thread::yield();
+					lock.lock();
+				}
+			}
+		}
+
+		////////////////////////////////////////////////////////////
+		// an uncapped run keeps the mutex between generations; callers
+		// announce themselves so the loop hands it over
+		template<typename Fn>
+		void locked(Fn&& fn) {
+			editors.fetch_add(1U, std::memory_order_acq_rel);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				fn();
+			}
+			editors.fetch_sub(1U, std::memory_order_acq_rel);
+			wake.notify_all();
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		Simulation(Engine& _engine, double _rate = 0.0): engine(_engine), target(_rate) {
+			publish();
+			worker = std::thread(&Simulation::run, this);
+		}
+
+		////////////////////////////////////////////////////////////
+		~Simulation() {
+			stop();
+		}
+
+		Simulation(const Simulation&) = delete;
+		Simulation& operator=(const Simulation&) = delete;
+
+		////////////////////////////////////////////////////////////
+		void stop() {
+			if (!worker.joinable()) { return; }
+			locked([&] { stopping = true; });
+			worker.join();
+		}
+
+		////////////////////////////////////////////////////////////
+		// latest finished generation; stays valid until the next call
+		const Snapshot& acquire() {
+			if (ready.load(std::memory_order_acquire) & fresh) {
+				front = ready.exchange(front, std::memory_order_acq_rel) & 3U;
+			}
+			return slots[front];
+		}
+
+		////////////////////////////////////////////////////////////
+		// runs fn(engine) between two generations and republishes
+		template<typename Fn>
+		void edit(Fn&& fn) {
+			locked([&] {
+				fn(engine);
+				publish();
+			});
+		}
+
+		////////////////////////////////////////////////////////////
+		// generation of the board; read it inside edit() so the
+		// stepping thread cannot move it
+		uint64_t Generation() const {
+			return engine_generation();
+		}
+
+		////////////////////////////////////////////////////////////
+		// generations per second, 0 = as fast as possible
+		void setRate(double rate) {
+			locked([&] {
+				target.store(rate < 0.0 ? 0.0 : rate, std::memory_order_relaxed);
+				++rate_changes;
+			});
+		}
+
+		////////////////////////////////////////////////////////////
+		double Rate() const noexcept {
+			return target.load(std::memory_order_relaxed);
+		}
+
+		////////////////////////////////////////////////////////////
+		void pause(bool value) {
+			locked([&] { paused = value; });
+		}
+
+		////////////////////////////////////////////////////////////
+		bool Paused() const noexcept {
+			return paused.load(std::memory_order_acquire);
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef TILE_LIFE_SO2U
+#define TILE_LIFE_SO2U
+
+#include "mewall.h"
+#include "Rule.hpp"
+#include "DoubleBuffer.hpp"
+#include "Hash.hpp"
+#include <vector>
+#include <algorithm>
+
+namespace mew::game {
+	struct TileStats {
+		size_t stepped = 0U;
+		size_t skipped = 0U;
+	};
+
+	// DoubleBuffer2d board split into TileSize x TileSize tiles.
+	// A tile is recomputed only when it or one of its 8 neighbors
+	// changed last generation; skipped tiles already hold the right
+	// cells in the back buffer, so buffers are pointer-swapped
+	// instead of copied and a still board costs nothing per step.
+	template<typename Rule = rules::Life, size_t TileSize = 32>
+	class BasicTileLife {
+	private:
+		DoubleBuffer2d<byte> buffer;
+		size_t tiles_x = 0U, tiles_y = 0U;
+		std::vector<byte> changed;
+		std::vector<byte> next_changed;
+		std::vector<uint64_t> tile_hash;
+		uint64_t board_hash = 0U;
+		TileStats last;
+		TileStats total;
+
+		////////////////////////////////////////////////////////////
+		size_t tile_idx(size_t tx, size_t ty) const noexcept {
+			return ty*tiles_x + tx;
+		}
+
+		////////////////////////////////////////////////////////////
+		bool is_active(size_t tx, size_t ty) const noexcept {
+			for (int dy = -1; dy <= 1; ++dy) {
+				for (int dx = -1; dx <= 1; ++dx) {
+					size_t nx = (tx + tiles_x + dx) % tiles_x;
+					size_t ny = (ty + tiles_y + dy) % tiles_y;
+					if (changed[tile_idx(nx, ny)]) { return true; }
+				}
+			}
+			return false;
+		}
+
+		////////////////////////////////////////////////////////////
+		// computes one tile into the back buffer and its new hash,
+		// true if any cell changed; rows are walked through the halo,
+		// so only the row above and below wrap, once per row
+		bool step_tile(size_t tx, size_t ty, uint64_t& tile) {
+			const size_t w = buffer.Width(), h = buffer.Height();
+			const size_t x0 = tx*TileSize, y0 = ty*TileSize;
+			const size_t x1 = std::min(x0 + TileSize, w);
+			const size_t y1 = std::min(y0 + TileSize, h);
+			bool any = false;
+			tile = 0xCBF29CE484222325ULL;
+			for (size_t y = y0; y < y1; ++y) {
+				const byte* up = buffer.row(y == 0 ? h - 1 : y - 1);
+				const byte* md = buffer.row(y);
+				const byte* dn = buffer.row(y + 1 == h ? 0 : y + 1);
+				byte* out = buffer.sub_row(y);
+				for (size_t x = x0; x < x1; ++x) {
+					size_t neighbors =
+						(size_t)(up[x-1] == Alive) + (size_t)(up[x] == Alive) + (size_t)(up[x+1] == Alive) +
+						(size_t)(md[x-1] == Alive) +                            (size_t)(md[x+1] == Alive) +
+						(size_t)(dn[x-1] == Alive) + (size_t)(dn[x] == Alive) + (size_t)(dn[x+1] == Alive);
+					byte next = Rule::next(md[x], neighbors);
+					out[x] = next;
+					any |= next != md[x];
+					tile = hash::Combine(tile, next);
+				}
+			}
+			return any;
+		}
+
+	public:
+		////////////////////////////////////////////////////////////
+		BasicTileLife() {}
+
+		////////////////////////////////////////////////////////////
+		BasicTileLife(size_t _w, size_t _h)
+			: buffer(_w, _h),
+			tiles_x((_w + TileSize - 1) / TileSize), tiles_y((_h + TileSize - 1) / TileSize),
+			changed(tiles_x*tiles_y, 1), next_changed(tiles_x*tiles_y, 0), tile_hash(tiles_x*tiles_y, 0U) {}
+
+		////////////////////////////////////////////////////////////
+		void clear(byte val) {
+			buffer.clear(val);
+			touch();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Width() const noexcept {
+			return buffer.Width();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t Height() const noexcept {
+			return buffer.Height();
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t TilesX() const noexcept {
+			return tiles_x;
+		}
+
+		////////////////////////////////////////////////////////////
+		size_t TilesY() const noexcept {
+			return tiles_y;
+		}
+
+		////////////////////////////////////////////////////////////
+		void set(size_t x, size_t y, byte val) {
+			buffer.set(x, y, val);
+		}
+
+		////////////////////////////////////////////////////////////
+		byte get(size_t x, size_t y) {
+			return buffer.get(x, y);
+		}
+
+		////////////////////////////////////////////////////////////
+		// the back buffer holds the previous generation after step(),
+		// call sync() before staging edits
+		void sync() {
+			buffer.sync();
+		}
+
+		////////////////////////////////////////////////////////////
+		void apply() {
+			buffer.apply();
+			touch();
+		}
+
+		////////////////////////////////////////////////////////////
+		// forces every tile to be recomputed next step
+		void touch() {
+			std::fill(changed.begin(), changed.end(), 1);
+		}
+
+		////////////////////////////////////////////////////////////
+		bool tileChanged(size_t tx, size_t ty) const noexcept {
+			return changed[tile_idx(tx, ty)];
+		}
+
+		////////////////////////////////////////////////////////////
+		void step() {
+			last = TileStats();
+			for (size_t ty = 0; ty < tiles_y; ++ty) {
+				for (size_t tx = 0; tx < tiles_x; ++tx) {
+					size_t idx = tile_idx(tx, ty);
+					if (is_active(tx, ty)) {
+						uint64_t h = 0U;
+						next_changed[idx] = step_tile(tx, ty, h);
+						/* skipped tiles keep their cells, so their hash term too */
+						board_hash += hash::Tile(idx, h) - hash::Tile(idx, tile_hash[idx]);
+						tile_hash[idx] = h;
+						++last.stepped;
+					} else {
+						next_changed[idx] = 0;
+						++last.skipped;
+					}
+				}
+			}
+			changed.swap(next_changed);
+			buffer.swap();
+			total.stepped += last.stepped;
+			total.skipped += last.skipped;
+		}
+
+		////////////////////////////////////////////////////////////
+		// hash of the current generation, updated per recomputed tile;
+		// valid from the first step() after an edit
+		uint64_t Hash() const noexcept {
+			return board_hash;
+		}
+
+		////////////////////////////////////////////////////////////
+		// counters of the last step()
+		TileStats Stats() const noexcept {
+			return last;
+		}
+
+		////////////////////////////////////////////////////////////
+		// counters summed over every step()
+		TileStats TotalStats() const noexcept {
+			return total;
+		}
+	};
+
+	typedef BasicTileLife<rules::Life, 32> TileLife;
+}
+
+#endif
@@ -0,0 +1,351 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "mewall.h"
+#include "Engines.hpp"
+#include "Pattern.hpp"
+#include "Cycle.hpp"
+#include "Census.hpp"
+#if __has_include(<sys/mman.h>)
+#include "MappedLife.hpp"
+#endif
+#if defined(__linux__)
+#include "ClusterLife.hpp"
+#endif
+
+// Headless Life benchmark: steps a seeded soup (or a .rle/.mc/.cells
+// pattern) for N generations without opening a window and reports
+// throughput and per-generation latency. --save writes the final
+// generation back out as a checkpoint that --pattern can resume from.
+//
+// game_of_life_bench --engine=bits --width=4096 --height=4096 --gens=1000
+//                    [--seed=1] [--density=0.5] [--warmup=10]
+//                    [--threads=0] [--step=0] [--pattern=file.rle]
+//                    [--rule=B36/S23] [--save=checkpoint.mc]
+//                    [--cycles=report|stop|skip] [--depth=1]
+//
+// --engine=blocked advances --depth generations per sweep of the board,
+// sharing its tiles among --threads threads; latency is reported per
+// generation.
+// --engine=mapped keeps the board in --file (default universe.life);
+// an existing file is resumed instead of seeding a new soup.
+// --engine=cluster splits the board over --threads worker processes
+// that trade halo rows through shared memory (Linux).
+// --census=N runs N random 16x16 soups on a 256x256 torus (--size
+// overrides the torus) until they settle, counts the objects left
+// behind by canonical name and reports soups/s; uses --rule, --seed
+// and --threads. Only two-state range-1 rules can be censused.
+// Configure with -DGOL_NATIVE_ARCH=ON to measure the AVX2 lanes.
+
+struct BenchOptions {
+	const char* engine = "bits";
+	const char* pattern = nullptr;
+	const char* save = nullptr;
+	const char* cycles = nullptr;
+	const char* rule = nullptr;
+	const char* file = "universe.life";
+	size_t width = 1024U;
+	size_t height = 1024U;
+	size_t gens = 1000U;
+	size_t warmup = 10U;
+	size_t threads = 0U;
+	size_t depth = 1U;
+	size_t census = 0U;
+	bool sized = false;
+	bool picked = false;  /* --engine was given */
+	uint64_t seed = 1U;
+	double density = 0.5;
+	byte step_log = 0;
+};
+
+BenchOptions ParseBenchOptions(int argc, char** argv) {
+	BenchOptions options;
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if (strncmp(arg, "--engine=", 9) == 0) { options.engine = arg+9; options.picked = true; }
+		else if (strncmp(arg, "--pattern=", 10) == 0) { options.pattern = arg+10; }
+		else if (strncmp(arg, "--save=", 7) == 0) { options.save = arg+7; }
+		else if (strncmp(arg, "--cycles=", 9) == 0) { options.cycles = arg+9; }
+		else if (strncmp(arg, "--rule=", 7) == 0) { options.rule = arg+7; }
+		else if (strncmp(arg, "--file=", 7) == 0) { options.file = arg+7; }
+		else if (strncmp(arg, "--width=", 8) == 0) { options.width = strtoull(arg+8, nullptr, 10); options.sized = true; }
+		else if (strncmp(arg, "--height=", 9) == 0) { options.height = strtoull(arg+9, nullptr, 10); options.sized = true; }
+		else if (strncmp(arg, "--size=", 7) == 0) { options.width = options.height = strtoull(arg+7, nullptr, 10); options.sized = true; }
+		else if (strncmp(arg, "--gens=", 7) == 0) { options.gens = strtoull(arg+7, nullptr, 10); }
+		else if (strncmp(arg, "--warmup=", 9) == 0) { options.warmup = strtoull(arg+9, nullptr, 10); }
+		else if (strncmp(arg, "--threads=", 10) == 0) { options.threads = strtoull(arg+10, nullptr, 10); }
+		else if (strncmp(arg, "--census=", 9) == 0) { options.census = strtoull(arg+9, nullptr, 10); }
+		else if (strncmp(arg, "--depth=", 8) == 0) { options.depth = strtoull(arg+8, nullptr, 10); }
+		else if (strncmp(arg, "--seed=", 7) == 0) { options.seed = strtoull(arg+7, nullptr, 10); }
+		else if (strncmp(arg, "--density=", 10) == 0) { options.density = atof(arg+10); }
+		else if (strncmp(arg, "--step=", 7) == 0) { options.step_log = (byte)atoi(arg+7); }
+		else {
+			fprintf(stderr, "unknown option: %s\n", arg);
+			exit(2);
+		}
+	}
+	return options;
+}
+
+template<typename Engine>
+void FillSoup(Engine& engine, const BenchOptions& options) {
+	std::mt19937_64 rng(options.seed);
+	std::bernoulli_distribution alive(options.density);
+	for (size_t y = 0; y < options.height; ++y) {
+		for (size_t x = 0; x < options.width; ++x) {
+			engine.set(x, y, alive(rng) ? Alive : Dead);
+		}
+	}
+	engine.apply();
+}
+
+template<typename Engine>
+int Bench(Engine& engine, const BenchOptions& options);
+
+// same run with cycle detection wrapped around the engine
+template<typename Engine>
+int BenchCycles(Engine& engine, const BenchOptions& options) {
+	mew::game::CycleLife<Engine&> life(engine);
+	if (strcmp(options.cycles, "stop") == 0) { life.setPolicy(mew::game::OnCycle::Stop); }
+	else if (strcmp(options.cycles, "skip") == 0) { life.setPolicy(mew::game::OnCycle::FastForward); }
+	else { life.setPolicy(mew::game::OnCycle::Continue); }
+	int code = Bench(life, options);
+	printf("period:            %zu\n", life.Period());
+	if (life.Period() != 0U) {
+		printf("stable since:      %llu\n", (unsigned long long)life.StableSince());
+	}
+	return code;
+}
+
+template<typename Engine>
+int Bench(Engine& engine, const BenchOptions& options) {
+	if constexpr (!requires { engine.Period(); }) {
+		if (options.cycles != nullptr) {
+			return BenchCycles(engine, options);
+		}
+	}
+	mew::game::PatternInfo info;
+	bool resumed = false;
+	if constexpr (requires { engine.Resumed(); }) {
+		resumed = engine.Resumed() && options.pattern == nullptr;
+	}
+	if (resumed) {
+		info.generation = mew::game::pattern::GenerationOf(engine, 0U);
+		printf("resumed:           %s (%zux%zu, gen %llu)\n", options.file,
+			engine.Width(), engine.Height(), (unsigned long long)info.generation);
+	} else if (options.pattern != nullptr) {
+		engine.clear(Dead);
+		auto t0 = std::chrono::steady_clock::now();
+		if (!mew::game::LoadPattern(engine, options.pattern, &info)) {
+			fprintf(stderr, "cannot load pattern: %s\n", options.pattern);
+			return 1;
+		}
+		double load_ms = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - t0).count();
+		printf("pattern:           %s (%zux%zu, gen %llu) in %.2f ms\n", options.pattern,
+			info.width, info.height, (unsigned long long)info.generation, load_ms);
+	} else {
+		engine.clear(Dead);
+		FillSoup(engine, options);
+	}
+	/* temporally blocked engines advance several generations per step */
+	size_t per_step = 1U;
+	if constexpr (requires { engine.Depth(); }) {
+		per_step = engine.Depth();
+	}
+	const size_t warmup_steps = (options.warmup + per_step - 1) / per_step;
+	const size_t steps = (options.gens + per_step - 1) / per_step;
+	/* engines that count generations are measured by them: a hashlife
+	   --step=k step is 2^k generations, a stopped cycle none */
+	uint64_t stepped = 0U;
+	auto generation = [&]() {
+		return mew::game::pattern::GenerationOf(engine, stepped*per_step);
+	};
+	const uint64_t first = generation();
+	for (size_t g = 0; g < warmup_steps; ++g) {
+		mew::game::Step(engine);
+		++stepped;
+	}
+	const uint64_t warmed = generation();
+	std::vector<double> samples;
+	samples.reserve(steps);
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t g = 0; g < steps; ++g) {
+		const uint64_t before = generation();
+		auto t0 = std::chrono::steady_clock::now();
+		mew::game::Step(engine);
+		auto t1 = std::chrono::steady_clock::now();
+		++stepped;
+		const uint64_t advanced = generation() - before;
+		samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() /
+			(double)(advanced > 0U ? advanced : 1U));
+	}
+	double total_ns = std::chrono::duration<double, std::nano>(
+		std::chrono::steady_clock::now() - begin).count();
+	const uint64_t gens = generation() - warmed;
+	if (samples.empty() || gens == 0U) {
+		printf("engine:            %s\n", options.engine);
+		printf("generations:       0 (the board did not advance)\n");
+		return 0;
+	}
+	std::sort(samples.begin(), samples.end());
+	auto percentile = [&](double p) {
+		size_t idx = (size_t)(p * (samples.size() - 1) + 0.5);
+		return samples[idx];
+	};
+	double cells = (double)options.width * (double)options.height;
+	double ns_per_gen = total_ns / (double)gens;
+	printf("engine:            %s\n", options.engine);
+	printf("board:             %zux%zu\n", options.width, options.height);
+	printf("generations:       %llu (+%llu warmup)\n", (unsigned long long)gens,
+		(unsigned long long)(warmed - first));
+	if (per_step > 1U) {
+		printf("depth:             %zu\n", per_step);
+	}
+	printf("cell-updates/s:    %.3e\n", cells * (double)gens / (total_ns * 1e-9));
+	printf("ns/generation:     %.0f\n", ns_per_gen);
+	printf("p50 latency (ns):  %.0f\n", percentile(0.50));
+	printf("p99 latency (ns):  %.0f\n", percentile(0.99));
+	if (options.save != nullptr) {
+		info.width = info.height = 0U;
+		info.generation += generation() - first;
+		info.rule = options.rule != nullptr ? options.rule : "B3/S23";
+		if (!mew::game::SavePattern(engine, options.save, info)) {
+			fprintf(stderr, "cannot save pattern: %s\n", options.save);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// random soup census, see Census.hpp
+int Census(const BenchOptions& options) {
+	bool ok = true;
+	mew::game::rules::Rule rule = options.rule != nullptr
+		? mew::game::rules::Rule::Parse(options.rule, &ok)
+		: mew::game::rules::Rule::Parse("B3/S23", &ok);
+	if (!ok) {
+		fprintf(stderr, "cannot parse rule: %s\n", options.rule);
+		return 2;
+	}
+	if (!mew::game::CensusSupports(rule)) {
+		fprintf(stderr, "census needs a two-state range-1 rule: %s\n", rule.name.c_str());
+		return 2;
+	}
+	mew::game::CensusOptions census;
+	census.soups = options.census;
+	census.threads = options.threads;
+	census.seed = options.seed;
+	if (options.sized) {
+		census.board = std::min(options.width, options.height);
+	}
+	if (census.board < 4U*census.soup) {
+		fprintf(stderr, "census board must be at least %zu cells\n", 4U*census.soup);
+		return 2;
+	}
+	return mew::game::DispatchRule(rule, [&](auto* tag) {
+		typedef std::remove_pointer_t<decltype(tag)> Engine;
+		mew::game::CensusReport report = mew::game::RunCensus<Engine>(rule, census);
+		report.print(stdout);
+		return 0;
+	});
+}
+
+int main(int argc, char** argv) {
+	BenchOptions options = ParseBenchOptions(argc, argv);
+	if (options.census > 0U) {
+		return Census(options);
+	}
+	mew::game::PatternInfo header;
+	if (options.rule == nullptr && options.pattern != nullptr &&
+		mew::game::ReadPatternInfo(options.pattern, header) && !header.rule.empty()) {
+		options.rule = header.rule.c_str();
+	}
+	bool ok = true;
+	mew::game::rules::Rule rule = options.rule != nullptr
+		? mew::game::rules::Rule::Parse(options.rule, &ok)
+		: mew::game::rules::Rule();
+	if (!ok) {
+		fprintf(stderr, "cannot parse rule: %s\n", options.rule);
+		return 2;
+	}
+	/* Life in any spelling runs on the --engine board */
+	if (options.rule != nullptr && !mew::game::rules::Matches<mew::game::rules::Life>(rule)) {
+		if (options.picked) {
+			fprintf(stderr, "rule %s overrides --engine=%s\n", options.rule, options.engine);
+		}
+		options.engine = options.rule;
+		return mew::game::DispatchRule(rule, [&](auto* tag) {
+			typedef std::remove_pointer_t<decltype(tag)> Engine;
+			Engine engine(options.width, options.height);
+			mew::game::ApplyRule(engine, rule);
+			return Bench(engine, options);
+		});
+	}
+	if (strcmp(options.engine, "classic") == 0) {
+		mew::game::DoubleBuffer2d<byte> engine(options.width, options.height);
+		return Bench(engine, options);
+	}
+	if (strcmp(options.engine, "bits") == 0) {
+		mew::game::BitBuffer2d engine(options.width, options.height);
+		return Bench(engine, options);
+	}
+	if (strcmp(options.engine, "blocked") == 0) {
+		mew::game::BlockedLife engine(options.width, options.height, options.depth, options.threads);
+		int code = Bench(engine, options);
+		printf("threads:           %zu\n", engine.Threads());
+		return code;
+	}
+	if (strcmp(options.engine, "tiles") == 0) {
+		mew::game::TileLife engine(options.width, options.height);
+		int code = Bench(engine, options);
+		mew::game::TileStats stats = engine.TotalStats();
+		printf("tiles stepped:     %zu\n", stats.stepped);
+		printf("tiles skipped:     %zu\n", stats.skipped);
+		return code;
+	}
+	if (strcmp(options.engine, "parallel") == 0) {
+		mew::game::ParallelLife engine(options.width, options.height, options.threads);
+		int code = Bench(engine, options);
+		printf("threads:           %zu\n", engine.Threads());
+		return code;
+	}
+#if defined(__linux__)
+	if (strcmp(options.engine, "cluster") == 0) {
+		mew::game::ClusterLife engine(options.width, options.height, options.threads);
+		int code = Bench(engine, options);
+		printf("workers:           %zu\n", engine.Workers());
+		return code;
+	}
+#endif
+#if __has_include(<sys/mman.h>)
+	if (strcmp(options.engine, "mapped") == 0) {
+		mew::game::MappedLife engine(options.file, options.width, options.height);
+		if (!engine.Good()) {
+			fprintf(stderr, "cannot map universe: %s (an existing file must be a universe of this rule)\n", options.file);
+			return 1;
+		}
+		options.width = engine.Width();
+		options.height = engine.Height();
+		int code = Bench(engine, options);
+		printf("generation:        %llu\n", (unsigned long long)engine.Generation());
+		return code;
+	}
+#endif
+	if (strcmp(options.engine, "hashlife") == 0) {
+		mew::game::HashLife engine(options.width, options.height);
+		engine.setStep(options.step_log);
+		int code = Bench(engine, options);
+		printf("generation:        %llu\n", (unsigned long long)engine.Generation());
+		printf("nodes:             %zu\n", engine.NodeCount());
+		return code;
+	}
+	fprintf(stderr, "unknown engine: %s\n", options.engine);
+	return 2;
+}
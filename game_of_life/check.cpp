@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "mewall.h"
+#include "Engines.hpp"
+#include "Pattern.hpp"
+#if __has_include(<sys/mman.h>)
+#include "MappedLife.hpp"
+#endif
+#if defined(__linux__)
+#include "ClusterLife.hpp"
+#endif
+
+// Headless equivalence check: every engine steps the same soups as the
+// reference byte board (DoubleBuffer2d + Step) and has to match it cell
+// for cell. Exits non-zero on the first board that differs, so ctest
+// catches an engine change that breaks the bit-for-bit claims.
+// A multi-state board is also written as RLE and read back, so the
+// two-letter "pA".."yX" states survive a checkpoint.
+//
+// game_of_life_check [--gens=48]
+
+struct Board {
+	size_t width, height;
+};
+
+static const Board boards[] = {
+	{200, 150}, {64, 64}, {130, 70}, {77, 33},
+};
+
+static size_t gens = 48U;
+static int failures = 0;
+
+////////////////////////////////////////////////////////////
+template<typename Engine>
+void Seed(Engine& engine, size_t w, size_t h, uint64_t seed) {
+	std::mt19937_64 rng(seed);
+	engine.clear(Dead);
+	for (size_t y = 0; y < h; ++y) {
+		for (size_t x = 0; x < w; ++x) {
+			engine.set(x, y, (rng() % 3U) == 0U ? Alive : Dead);
+		}
+	}
+	engine.apply();
+}
+
+////////////////////////////////////////////////////////////
+// steps `engine` next to the reference and compares them after every
+// step; `per_step` is the generations one step() advances
+template<typename Engine>
+void Compare(const char* name, Engine& engine, const Board& board, size_t per_step = 1U) {
+	mew::game::DoubleBuffer2d<byte> reference(board.width, board.height);
+	const uint64_t seed = board.width*1000U + board.height;
+	Seed(reference, board.width, board.height, seed);
+	Seed(engine, board.width, board.height, seed);
+	for (size_t g = 0; g < gens; g += per_step) {
+		for (size_t i = 0; i < per_step; ++i) {
+			mew::game::Step(reference);
+		}
+		engine.step();
+		for (size_t y = 0; y < board.height; ++y) {
+			for (size_t x = 0; x < board.width; ++x) {
+				if (IsAlive(reference.get(x, y)) != IsAlive(engine.get(x, y))) {
+					printf("FAIL %-9s %zux%zu: cell (%zu, %zu) differs at generation %zu\n",
+						name, board.width, board.height, x, y, g + per_step);
+					++failures;
+					return;
+				}
+			}
+		}
+	}
+	printf("ok   %-9s %zux%zu\n", name, board.width, board.height);
+}
+
+////////////////////////////////////////////////////////////
+// runs of every state of a Generations rule with more than 24 states,
+// saved as RLE and loaded into an empty board
+void RoundTrip(const char* rule_name) {
+	bool ok = false;
+	const mew::game::rules::Rule rule = mew::game::rules::Rule::Parse(rule_name, &ok);
+	if (!ok) {
+		printf("FAIL rle       cannot parse %s\n", rule_name);
+		++failures;
+		return;
+	}
+	const size_t w = 90U, h = 40U;
+	mew::game::RuleEngine<mew::game::rules::Rule> saved(w, h, rule), loaded(w, h, rule);
+	std::mt19937_64 rng(rule.states);
+	saved.clear(Dead);
+	for (size_t y = 0; y < h; ++y) {
+		for (size_t x = 0; x < w;) {
+			const byte val = (byte)(rng() % rule.states);
+			for (size_t run = 1U + rng() % 5U; run > 0U && x < w; --run, ++x) {
+				saved.set(x, y, val);
+			}
+		}
+	}
+	saved.apply();
+	mew::game::PatternInfo info;
+	info.width = w;
+	info.height = h;
+	info.states = rule.states;
+	info.rule = rule_name;
+	std::stringstream file;
+	if (!mew::game::SaveRLE(saved, file, info) || !mew::game::LoadRLE(loaded, file)) {
+		printf("FAIL rle       %s does not round-trip\n", rule_name);
+		++failures;
+		return;
+	}
+	for (size_t y = 0; y < h; ++y) {
+		for (size_t x = 0; x < w; ++x) {
+			if (saved.get(x, y) != loaded.get(x, y)) {
+				printf("FAIL rle       %s: cell (%zu, %zu) saved %d, loaded %d\n",
+					rule_name, x, y, saved.get(x, y), loaded.get(x, y));
+				++failures;
+				return;
+			}
+		}
+	}
+	printf("ok   rle       %s\n", rule_name);
+}
+
+int main(int argc, char** argv) {
+	for (int i = 1; i < argc; ++i) {
+		if (strncmp(argv[i], "--gens=", 7) == 0) { gens = strtoull(argv[i]+7, nullptr, 10); }
+		else {
+			fprintf(stderr, "unknown option: %s\n", argv[i]);
+			return 2;
+		}
+	}
+	for (const Board& board: boards) {
+		{
+			mew::game::BitBuffer2d engine(board.width, board.height);
+			Compare("bits", engine, board);
+		}
+		{
+			mew::game::TileLife engine(board.width, board.height);
+			Compare("tiles", engine, board);
+		}
+		{
+			mew::game::ParallelLife engine(board.width, board.height, 3U);
+			Compare("parallel", engine, board);
+		}
+		{
+			mew::game::BlockedLife engine(board.width, board.height, 4U);
+			Compare("blocked", engine, board, 4U);
+		}
+#if defined(__linux__)
+		{
+			mew::game::ClusterLife engine(board.width, board.height, 3U);
+			Compare("cluster", engine, board);
+		}
+#endif
+#if __has_include(<sys/mman.h>)
+		{
+			const std::string path = "check-" + std::to_string(board.width) + "x" +
+				std::to_string(board.height) + ".life";
+			remove(path.c_str());
+			{
+				mew::game::MappedLife engine(path.c_str(), board.width, board.height);
+				if (!engine.Good()) {
+					printf("FAIL mapped    cannot map %s\n", path.c_str());
+					++failures;
+				} else {
+					Compare("mapped", engine, board);
+				}
+			}
+			remove(path.c_str());
+		}
+#endif
+	}
+	RoundTrip("B2/S/C64");
+	if (failures > 0) {
+		printf("%d check(s) failed\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -1,41 +1,113 @@
+#include <chrono>
 #include <iostream>
+#include <thread>
+#include <stdlib.h>
+#include <string.h>
+#include <type_traits>
 #include "raylib.h"
 #include "mewall.h"
 #include "ConsoleRenderer.hpp"
-#include "LoopWaiter.hpp"
+#include "Simulation.hpp"
+#include "Rule.hpp"
+#include "Pattern.hpp"
+#include "LifeView.hpp"
 
-#define Alive (byte)1
-#define Dead (byte)0
-#define IsAlive(cr) ((cr)==Alive)
-#define IsDead(cr) ((cr)==Dead)
+struct Options {
+	const char* engine = "classic";
+	bool picked = false;  /* --engine was given */
+	byte step_log = 0;
+	size_t threads = 0U;
+	const char* rule = nullptr;
+	const char* pattern = nullptr;
+	const char* save = nullptr;  /* checkpoint.mc for hashlife, else checkpoint.rle */
+	size_t width = 100U;
+	size_t height = 100U;
+	bool console = false;
+	size_t delay = 100U;
+	size_t gens = 0U;
+	double rate = 10.0;
+};
 
-size_t cell_size = 20;
-
-void DrawGrid(int width, int height, int cellSize) {
-	for (int x = 0; x <= width; x += cellSize) {
-		DrawLine(x, 0, x, height, BLACK);
+Options ParseOptions(int argc, char** argv) {
+	Options options;
+	for (int i = 1; i < argc; ++i) {
+		if (strncmp(argv[i], "--engine=", 9) == 0) {
+			options.engine = argv[i]+9;
+			options.picked = true;
+		}
+		else if (strncmp(argv[i], "--step=", 7) == 0) {
+			options.step_log = (byte)atoi(argv[i]+7);
+		}
+		else if (strncmp(argv[i], "--threads=", 10) == 0) {
+			options.threads = (size_t)atoi(argv[i]+10);
+		}
+		else if (strncmp(argv[i], "--rule=", 7) == 0) {
+			options.rule = argv[i]+7;
+		}
+		else if (strncmp(argv[i], "--pattern=", 10) == 0) {
+			options.pattern = argv[i]+10;
+		}
+		else if (strncmp(argv[i], "--save=", 7) == 0) {
+			options.save = argv[i]+7;
+		}
+		else if (strncmp(argv[i], "--width=", 8) == 0) {
+			options.width = (size_t)atoi(argv[i]+8);
+		}
+		else if (strncmp(argv[i], "--height=", 9) == 0) {
+			options.height = (size_t)atoi(argv[i]+9);
+		}
+		else if (strcmp(argv[i], "--console") == 0) {
+			options.console = true;
+		}
+		else if (strncmp(argv[i], "--delay=", 8) == 0) {
+			options.delay = (size_t)atoi(argv[i]+8);
+		}
+		else if (strncmp(argv[i], "--gens=", 7) == 0) {
+			options.gens = (size_t)atoi(argv[i]+7);
+		}
+		else if (strncmp(argv[i], "--rate=", 7) == 0) {
+			options.rate = atof(argv[i]+7);
+		}
+	}
+	/* blocked and mapped only make sense headless, in game_of_life_bench */
+	if (strcmp(options.engine, "blocked") == 0 || strcmp(options.engine, "mapped") == 0) {
+		std::cerr << "--engine=" << options.engine << " is only available in game_of_life_bench" << std::endl;
+		exit(2);
 	}
-	for (int y = 0; y <= height; y += cellSize) {
-		DrawLine(0, y, width, y, BLACK);
+	static const char* const engines[] = {
+		"classic", "bits", "hashlife", "tiles", "parallel",
+#if defined(__linux__)
+		"cluster",
+#endif
+	};
+	bool known = false;
+	for (const char* name: engines) {
+		known = known || strcmp(options.engine, name) == 0;
 	}
+	if (!known) {
+		std::cerr << "unknown engine: " << options.engine << std::endl;
+		exit(2);
+	}
+	return options;
 }
 
 void Printer(std::ostream& os, byte cur) {
-	os << (IsAlive(cur)?'#': '.');
+	os << (IsAlive(cur)?'#': (IsDead(cur)? '.': '+'));
 }
 
-mew::game::ConsoleRenderer renderer(100U, 100U, Printer);
-
-void RenderCells() {
-	for (int x = 0; x < renderer.Width(); ++x) {
-		for (int y = 0; y < renderer.Height(); ++y) {
-			DrawRectangle(x*cell_size, y*cell_size, cell_size, cell_size, IsAlive(renderer.buffer.get(x, y))?BLACK:WHITE);
-		}
-	}
+Color CellColor(byte cur) {
+	return IsAlive(cur)? BLACK: (IsDead(cur)? WHITE: GRAY);
 }
 
-void start() {
+template<typename Renderer>
+void start(Renderer& renderer, const Options& options) {
   renderer.buffer.clear(Dead);
+	if (options.pattern != nullptr) {
+		if (mew::game::LoadPattern(renderer.buffer, options.pattern)) {
+			return;
+		}
+		std::cerr << "cannot load pattern: " << options.pattern << std::endl;
+	}
 	/*******************************/
   renderer.buffer.set(3, 1, Alive);
 	/*******************************/
@@ -48,35 +120,12 @@ void start() {
 	renderer.buffer.apply();
 }
 
-void update() {
-	renderer.buffer.sync();
-	for (int x = 0; x < renderer.Width(); ++x) {
-    for (int y = 0; y < renderer.Height(); ++y) { 
-			size_t neightbors = renderer.buffer.calc_near(x, y, Alive);
-			byte current = renderer.buffer.get(x, y);
-			if (IsDead(current) && neightbors == 3) {
-				renderer.buffer.set(x, y, Alive);
-      }
-      else if (IsAlive(current) && (neightbors < 2 || neightbors > 3)) {
-				renderer.buffer.set(x, y, Dead);
-      }
-		} 
-	}
-	renderer.buffer.apply();
-}
-
-void render() {
-	// system("CLS");
-	RenderCells();
-	DrawGrid(renderer.Width()*cell_size, renderer.Height()*cell_size, cell_size);
-	// renderer.Render(std::cout, '\n');
-}
-
 int GetRandomValue() {
 	return GetRandomValue(0, INT_MAX);
 }
 
-void fillRandom() {
+template<typename Renderer>
+void fillRandom(Renderer& renderer) {
 	for (int x = 0; x < renderer.Width(); ++x) {
 		for (int y = 0; y < renderer.Height(); ++y) {
 			renderer.buffer.set(x, y, (GetRandomValue()%2)?Alive:Dead);
@@ -85,34 +134,163 @@ void fillRandom() {
 	renderer.buffer.apply();
 }
 
-int main() {
-	constexpr size_t __time = 100U;
+// terminal mode: diffed ANSI frames, one generation per --delay ms,
+// forever unless --gens is given
+template<typename Renderer>
+int runConsole(Renderer& renderer, const Options& options) {
+	start(renderer, options);
+	mew::game::AnsiTerminal terminal;
+	auto next = std::chrono::steady_clock::now();
+	for (size_t g = 0; options.gens == 0 || g < options.gens; ++g) {
+		renderer.Present(terminal, std::cout);
+		mew::game::Step(renderer.buffer);
+		next += std::chrono::milliseconds(options.delay);
+		std::this_thread::sleep_until(next);
+	}
+	renderer.Present(terminal, std::cout);
+	terminal.restore(std::cout);
+	return 0;
+}
+
+// HashLife checkpoints are macrocell: RLE would cut the universe down
+// to the window
+template<typename Engine>
+const char* CheckpointPath(const Engine& engine, const Options& options) {
+	if constexpr (requires { engine.Root(); }) {
+		if (options.save == nullptr) { return "checkpoint.mc"; }
+		if (!mew::game::pattern::EndsWith(options.save, ".mc")) {
+			std::cerr << "--save=" << options.save << " keeps only the "
+				<< engine.Width() << "x" << engine.Height() << " window, use .mc for the whole universe" << std::endl;
+		}
+	}
+	return options.save != nullptr ? options.save : "checkpoint.rle";
+}
+
+template<typename Renderer>
+int run(Renderer& renderer, const Options& options) {
+	if (options.console) {
+		return runConsole(renderer, options);
+	}
 	InitWindow(500, 500, "Game of Life");
 	SetWindowState(FLAG_WINDOW_RESIZABLE);
-	SetTargetFPS(0);
-	start();
-	mew::game::LoopWaiter waiter;
+	SetTargetFPS(60);
+	start(renderer, options);
+	/* the board steps on its own thread, frames draw the latest snapshot */
+	mew::game::Simulation<typename Renderer::buffer_type> simulation(renderer.buffer, options.rate);
+	/* pan with the right mouse button or arrows, zoom with the wheel */
+	mew::game::LifeView view(CellColor);
 	while(!WindowShouldClose()) {
 		PollInputEvents();
 		if (IsKeyPressed(KEY_ESCAPE)) {
 			break;
 		}
 		if (IsKeyPressed(KEY_SPACE)) {
-			renderer.buffer.clear(Dead);
-			fillRandom();
+			simulation.edit([&](auto& buffer) {
+				buffer.clear(Dead);
+				fillRandom(renderer);
+			});
 		}
-		cell_size += GetMouseWheelMove();
-		if (waiter.Wait(__time)) {
-			ClearBackground(RAYWHITE);
-			BeginDrawing();
-				render();
-				update();
-				DrawText("Press SPACE to fill random cells", 10, 10, 20, RED);
-				DrawText("Press ESC to exit", 10, 30, 20, RED);
-			EndDrawing();
+		if (IsKeyPressed(KEY_S)) {
+			simulation.edit([&](auto& buffer) {
+				mew::game::PatternInfo info;
+				info.rule = options.rule != nullptr ? options.rule : "B3/S23";
+				info.generation = simulation.Generation();
+				if constexpr (requires { buffer.getRule(); }) {
+					info.states = buffer.getRule().states;
+				}
+				const char* path = CheckpointPath(buffer, options);
+				if (!mew::game::SavePattern(buffer, path, info)) {
+					std::cerr << "cannot save pattern: " << path << std::endl;
+				}
+			});
+		}
+		if (IsKeyPressed(KEY_P)) {
+			simulation.pause(!simulation.Paused());
+		}
+		if (IsKeyPressed(KEY_EQUAL) && simulation.Rate() > 0.0) {
+			simulation.setRate(simulation.Rate() * 2.0);
+		}
+		if (IsKeyPressed(KEY_MINUS)) {
+			simulation.setRate(simulation.Rate() > 0.0 ? simulation.Rate() / 2.0 : 1024.0);
 		}
-		// 	printf("time: %llu", __time);
-		// }
+		if (IsKeyPressed(KEY_F)) {
+			view.fit(renderer.Width(), renderer.Height(), GetScreenWidth(), GetScreenHeight());
+		}
+		view.handleInput();
+		const mew::game::Snapshot& frame = simulation.acquire();
+		BeginDrawing();
+			ClearBackground(RAYWHITE);
+			view.draw(frame, (Rectangle){0.0f, 0.0f, (float)GetScreenWidth(), (float)GetScreenHeight()});
+			DrawText("Press SPACE to fill random cells", 10, 10, 20, RED);
+			DrawText("Press ESC to exit, S to save a checkpoint, F to fit", 10, 30, 20, RED);
+			DrawText(TextFormat("generation %llu, %.0f gen/s (P pause, +/- rate)",
+				(unsigned long long)frame.generation, frame.rate), 10, 50, 20, RED);
+			DrawText(TextFormat("zoom %.3f px/cell, mip level %zu", view.Zoom(), view.Level()), 10, 70, 20, RED);
+			if (frame.tiles.stepped + frame.tiles.skipped > 0U) {
+				DrawText(TextFormat("tiles stepped: %zu skipped: %zu",
+					frame.tiles.stepped, frame.tiles.skipped), 10, 90, 20, RED);
+			}
+		EndDrawing();
 	}
+	simulation.stop();
+	return 0;
 }
 
+int main(int argc, char** argv) {
+	Options options = ParseOptions(argc, argv);
+	mew::game::PatternInfo header;
+	if (options.rule == nullptr && options.pattern != nullptr &&
+		mew::game::ReadPatternInfo(options.pattern, header) && !header.rule.empty()) {
+		options.rule = header.rule.c_str();
+	}
+	bool ok = true;
+	mew::game::rules::Rule rule = options.rule != nullptr
+		? mew::game::rules::Rule::Parse(options.rule, &ok)
+		: mew::game::rules::Rule();
+	if (!ok) {
+		std::cerr << "cannot parse rule: " << options.rule << std::endl;
+		return 2;
+	}
+	/* Life in any spelling runs on the --engine board */
+	if (options.rule != nullptr && !mew::game::rules::Matches<mew::game::rules::Life>(rule)) {
+		if (options.picked) {
+			std::cerr << "rule " << options.rule << " overrides --engine=" << options.engine << std::endl;
+		}
+		return mew::game::DispatchRule(rule, [&](auto* tag) {
+			typedef std::remove_pointer_t<decltype(tag)> Engine;
+			mew::game::BasicConsoleRenderer<Engine> renderer(options.width, options.height, Printer);
+			mew::game::ApplyRule(renderer.buffer, rule);
+			return run(renderer, options);
+		});
+	}
+	if (strcmp(options.engine, "bits") == 0) {
+		mew::game::BitConsoleRenderer renderer(options.width, options.height, Printer);
+		return run(renderer, options);
+	}
+	if (strcmp(options.engine, "hashlife") == 0) {
+		mew::game::HashConsoleRenderer renderer(options.width, options.height, Printer);
+		renderer.buffer.setStep(options.step_log);
+		return run(renderer, options);
+	}
+	if (strcmp(options.engine, "tiles") == 0) {
+		mew::game::TileConsoleRenderer renderer(options.width, options.height, Printer);
+		return run(renderer, options);
+	}
+	if (strcmp(options.engine, "parallel") == 0) {
+		mew::game::ParallelConsoleRenderer renderer(options.width, options.height, Printer);
+		renderer.buffer.setThreads(options.threads);
+		return run(renderer, options);
+	}
+#if defined(__linux__)
+	if (strcmp(options.engine, "cluster") == 0) {
+		/* --threads counts worker processes here */
+		mew::game::ClusterConsoleRenderer renderer(options.width, options.height, Printer);
+		if (options.threads != 0U) {
+			renderer.buffer.setWorkers(options.threads);
+		}
+		return run(renderer, options);
+	}
+#endif
+	mew::game::ConsoleRenderer renderer(options.width, options.height, Printer);
+	return run(renderer, options);
+}
@@ -9,6 +9,7 @@ extern "C" {
 #include "geomentry.hpp"
 #include "ui.hpp"
 #include "particles.hpp"
+#include "Grid2D.hpp"
 
 static const float cell_size = 32.0f;
 
@@ -124,11 +125,13 @@ public:
 	Vector2 selected_cell = {-1, -1};
 	bool down_cell_is_path = false;
 	Vector2 hover_cell;
-	byte** _temp_map;
-	Level(size_t width, size_t height): width(width), height(height) {
-		_temp_map = new byte*[width];
-		for (int i = 0; i < width; ++i) {
-			_temp_map[i] = new byte[height];
+	// one contiguous block indexed [x][y] (rows are columns), the
+	// row table keeps the byte** view getRoadType expects
+	mew::Grid2D<byte> _temp_map;
+	std::vector<byte*> _temp_rows;
+	Level(size_t width, size_t height): width(width), height(height), _temp_map(height, width), _temp_rows(width) {
+		for (size_t x = 0; x < width; ++x) {
+			_temp_rows[x] = _temp_map.row(x);
 		}
 	}
 
@@ -246,11 +249,7 @@ public:
 		float real_cell_size = cell_size;
 
 		TextureAtlas* storage = GetCurrentTextureAtlas();
-		for (int x = 0; x < width; ++x) {
-			for (int y = 0; y < height; ++y) {
-				_temp_map[x][y] = 0;
-			}
-		}
+		_temp_map.fill(0);
 		// grass->texture.width = real_cell_size;
 		// grass->texture.height = real_cell_size;
 		// track->texture.width = real_cell_size;
@@ -274,7 +273,7 @@ public:
 				if (!(position.x < 0 || position.y < 0 || position.x >= width || position.y >= height)) {
 					// position.x *= real_cell_size;
 					// position.y *= real_cell_size;
-					_temp_map[(int)position.x][(int)position.y] = 1;
+					_temp_map.row((int)position.x)[(int)position.y] = 1;
 					// storage->draw("track", position);
 				}
 			}
@@ -282,8 +281,8 @@ public:
 
 		for (int x = 0; x < width; ++x) {
 			for (int y = 0; y < height; ++y) {
-				byte current = _temp_map[x][y];
-				mew::RoadType rt = mew::getRoadType(_temp_map, width, height, x, y);
+				byte current = _temp_rows[x][y];
+				mew::RoadType rt = mew::getRoadType(_temp_rows.data(), width, height, x, y);
 				const char* prefix = mew::rt_to_prefix(rt);
 				char* name = mew::string::join_str(1 == current? "track": "grass", prefix, "-");
 				storage->draw(name, (Vector2){x*real_cell_size, y*real_cell_size});